@@ -0,0 +1,101 @@
+#!/bin/bash
+
+# runs .il files through the optimizer once for each of the pass strings
+# below, and checks that every optimized program prints the same thing as the
+# original, which is the reference. by default every file in ../input is
+# checked, or just the files given as arguments.
+#
+# the simulator can be changed by setting ILOC, it's run as
+# $ILOC <file> < <input>
+
+# pass strings to check, each optionally followed by a target
+runs=(
+  "lsdr"
+  "lsdr 6"
+  "lsdp"
+  "lsdp 6"
+  "lsdf"
+  "lsdf 6"
+  "lsdf int=12,float=6"
+  "lsdc"
+  "lsdc int=12,float=6"
+  "lsdc int=8,float=2"
+  "lsdc 6"
+  "sn"
+  "lsdn"
+  "mlsdr"
+  "mlsdf"
+  "mlsdc"
+  "mlsdn"
+  "lsdir"
+  "lsdir int=12,float=6"
+  "lsdif"
+  "lsdic"
+  "lsdin"
+)
+
+# inputs a run leaves out, by run. with 6 registers only 2 are handed out,
+# and quicksort takes 3 arguments. spilling everywhere never gets main of
+# dynamic down to 2 registers, see large live ranges in the readme.
+declare -A skips=(
+  ["lsdr 6"]="qs dynamic"
+  ["lsdp 6"]="qs"
+  ["lsdf 6"]="qs"
+  ["lsdc 6"]="qs"
+)
+
+ILOC=${ILOC:-"java -jar ../iloc.jar"}
+failures=0
+
+# arguments:
+# 1: filename
+run_on_file() {
+  # the input file has the same name with a .in extension
+  input="${1%.*}.in"
+  if ! test -f $input ; then
+    input=/dev/null
+  fi
+
+  $ILOC $1 < $input > reference.txt 2>&1
+
+  name=$(basename "${1%.*}")
+
+  for run in "${runs[@]}" ; do
+    if [[ " ${skips[$run]} " == *" $name "* ]] ; then
+      continue
+    fi
+
+    if ! ./driver $1 $run > output.il 2> /dev/null ; then
+      echo "FAILED: $1 with $run, the driver failed"
+      failures=$((failures + 1))
+      continue
+    fi
+
+    $ILOC output.il < $input > optimized.txt 2>&1
+    if ! diff reference.txt optimized.txt > /dev/null ; then
+      echo "FAILED: $1 with $run"
+      diff reference.txt optimized.txt | head -n 10
+      failures=$((failures + 1))
+    fi
+  done
+}
+
+if [ $# -eq 0 ] ; then
+  files=(../input/*.il)
+else
+  files=("$@")
+fi
+
+for f in "${files[@]}" ; do
+  echo running on $f
+  run_on_file $f
+done
+
+# clean up
+rm -f reference.txt optimized.txt output.il
+
+if [ $failures -ne 0 ] ; then
+  echo "$failures runs failed."
+  exit 1
+fi
+echo "every run matched the reference."
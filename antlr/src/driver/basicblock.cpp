@@ -1,13 +1,11 @@
 #include "basicblock.h"
 
-uint BasicBlock::nextOrder = 0;
-
 bool operator<(const BasicBlock &a, const BasicBlock &b) {
   return a.debugName < b.debugName;
 }
 
 bool operator==(const BasicBlock &a, const BasicBlock &b) {
-  return a.debugName == b.debugName && a.order == b.order &&
+  return a.debugName == b.debugName && a.id == b.id &&
          a.after == b.after && a.before == b.before &&
          a.instructions == b.instructions;
 }
@@ -17,7 +15,7 @@ bool operator!=(const BasicBlock &a, const BasicBlock &b) {
 }
 
 BasicBlock::BasicBlock(std::string str)
-    : debugName(str), order(BasicBlock::nextOrder++) {}
+    : debugName(str), id(0) {}
 
 Instruction &BasicBlock::findInstruction(Instruction findInst) {
   for (auto &inst : instructions) {
@@ -12,13 +12,13 @@ public:
   Instruction &findInstruction(Instruction inst);
 
   std::vector<PhiNode> phinodes;
-  std::vector<std::string> before;
-  std::vector<std::string> after;
+  // predecessor and successor block ids
+  std::vector<unsigned int> before;
+  std::vector<unsigned int> after;
   std::vector<Instruction> instructions;
   std::string debugName;
-  uint order;
-
-  static uint nextOrder;
+  // index of this block in its procedure's block list
+  unsigned int id;
 
 private:
 };
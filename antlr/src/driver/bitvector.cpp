@@ -0,0 +1,131 @@
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "bitvector.h"
+
+#ifdef __SSE2__
+static bool anyBits(__m128i v) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xffff;
+}
+#endif
+
+BitVector::BitVector(unsigned int size)
+    : _words((size + 63) / 64, 0), _size(size) {}
+
+unsigned int BitVector::size() const { return _size; }
+
+bool BitVector::test(unsigned int i) const {
+  return (_words[i / 64] >> (i % 64)) & 1;
+}
+
+void BitVector::set(unsigned int i) {
+  _words[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+void BitVector::reset(unsigned int i) {
+  _words[i / 64] &= ~(uint64_t(1) << (i % 64));
+}
+
+void BitVector::clear() {
+  for (auto &word : _words) {
+    word = 0;
+  }
+}
+
+bool BitVector::any() const {
+  for (auto word : _words) {
+    if (word != 0)
+      return true;
+  }
+  return false;
+}
+
+bool BitVector::unionWith(const BitVector &other) {
+  uint64_t *dst = _words.data();
+  const uint64_t *src = other._words.data();
+  unsigned int n = _words.size();
+  unsigned int w = 0;
+
+#ifdef __SSE2__
+  __m128i changed = _mm_setzero_si128();
+  for (; w + 2 <= n; w += 2) {
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + w));
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + w));
+    __m128i r = _mm_or_si128(d, s);
+    changed = _mm_or_si128(changed, _mm_xor_si128(r, d));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + w), r);
+  }
+  bool dirty = anyBits(changed);
+#else
+  bool dirty = false;
+#endif
+
+  for (; w < n; w++) {
+    uint64_t r = dst[w] | src[w];
+    dirty |= r != dst[w];
+    dst[w] = r;
+  }
+
+  return dirty;
+}
+
+void BitVector::subtract(const BitVector &other) {
+  uint64_t *dst = _words.data();
+  const uint64_t *src = other._words.data();
+  unsigned int n = _words.size();
+  unsigned int w = 0;
+
+#ifdef __SSE2__
+  for (; w + 2 <= n; w += 2) {
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + w));
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + w));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + w),
+                     _mm_andnot_si128(s, d));
+  }
+#endif
+
+  for (; w < n; w++) {
+    dst[w] &= ~src[w];
+  }
+}
+
+bool BitVector::assignUnionDifference(const BitVector &a, const BitVector &b,
+                                      const BitVector &c) {
+  uint64_t *dst = _words.data();
+  const uint64_t *pa = a._words.data();
+  const uint64_t *pb = b._words.data();
+  const uint64_t *pc = c._words.data();
+  unsigned int n = _words.size();
+  unsigned int w = 0;
+
+#ifdef __SSE2__
+  __m128i changed = _mm_setzero_si128();
+  for (; w + 2 <= n; w += 2) {
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + w));
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pa + w));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pb + w));
+    __m128i vc = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pc + w));
+    __m128i r = _mm_or_si128(va, _mm_andnot_si128(vc, vb));
+    changed = _mm_or_si128(changed, _mm_xor_si128(r, d));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + w), r);
+  }
+  bool dirty = anyBits(changed);
+#else
+  bool dirty = false;
+#endif
+
+  for (; w < n; w++) {
+    uint64_t r = pa[w] | (pb[w] & ~pc[w]);
+    dirty |= r != dst[w];
+    dst[w] = r;
+  }
+
+  return dirty;
+}
+
+bool operator==(const BitVector &a, const BitVector &b) {
+  return a._size == b._size && a._words == b._words;
+}
+
+bool operator!=(const BitVector &a, const BitVector &b) { return !(a == b); }
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// fixed size set of small integers, one bit per element. the set operations
+// work a machine word at a time, or two words at a time with sse2.
+class BitVector {
+public:
+  BitVector() = default;
+  explicit BitVector(unsigned int size);
+
+  unsigned int size() const;
+  bool test(unsigned int i) const;
+  void set(unsigned int i);
+  void reset(unsigned int i);
+  void clear();
+  bool any() const;
+
+  // this |= other. returns true if this changed.
+  bool unionWith(const BitVector &other);
+  // this &= ~other
+  void subtract(const BitVector &other);
+  // this = a | (b & ~c). returns true if this changed.
+  bool assignUnionDifference(const BitVector &a, const BitVector &b,
+                             const BitVector &c);
+
+  // calls f(i) for each element i in the set, in ascending order
+  template <typename F> void forEach(F f) const;
+
+  friend bool operator==(const BitVector &a, const BitVector &b);
+
+private:
+  std::vector<uint64_t> _words;
+  unsigned int _size = 0;
+};
+
+bool operator==(const BitVector &a, const BitVector &b);
+bool operator!=(const BitVector &a, const BitVector &b);
+
+template <typename F> void BitVector::forEach(F f) const {
+  for (unsigned int w = 0; w < _words.size(); w++) {
+    uint64_t word = _words[w];
+    while (word != 0) {
+      f(w * 64 + __builtin_ctzll(word));
+      word &= word - 1;
+    }
+  }
+}
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <unordered_set>
+
+#include "callsummarypass.h"
+
+static bool isCall(const Operation &op) {
+  return op.opcode == ilocParser::CALL || op.opcode == ilocParser::ICALL ||
+         op.opcode == ilocParser::FCALL;
+}
+
+// the function name is the only label of a call
+static std::string getCallee(const Operation &op) {
+  for (const auto &rval : op.rvalues) {
+    if (rval.getType() == Value::Type::label) {
+      return rval.getName();
+    }
+  }
+  throw "call without a function name";
+}
+
+void CallSummaryPass::run(IlocProgram &prog) {
+  if (prog.isSSA()) {
+    throw "call summaries have to be computed before ssa!";
+  }
+
+  std::cerr << "summarizing arguments written by calls\n";
+
+  _summaries.clear();
+  _components.clear();
+  _unwritten = 0;
+
+  buildCallGraph(prog);
+
+  unsigned int size = prog.getProcedures().size();
+  _indices.assign(size, -1);
+  _lowLinks.assign(size, 0);
+  _onStack.assign(size, false);
+  _stack.clear();
+  _nextIndex = 0;
+  for (unsigned int i = 0; i < size; i++) {
+    if (_indices[i] == -1) {
+      findComponents(i);
+    }
+  }
+
+  const auto &procedures = prog.getProcedures();
+  for (const auto &component : _components) {
+    // recursion only ever adds arguments, so start from none
+    for (auto id : component) {
+      const IlocProcedure &proc = procedures[id];
+      _summaries[proc.getFrame().name] =
+          std::vector<bool>(proc.getFrame().arguments.size(), false);
+    }
+
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (auto id : component) {
+        const IlocProcedure &proc = procedures[id];
+        std::vector<bool> summary = summarize(proc);
+        if (summary != _summaries[proc.getFrame().name]) {
+          _summaries[proc.getFrame().name] = summary;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  for (auto &proc : prog.getProceduresReference()) {
+    rewriteCalls(proc);
+  }
+
+  std::cerr << _unwritten << " call arguments never written by the callee.\n";
+}
+
+bool CallSummaryPass::writesArgument(const std::string &procedure,
+                                     unsigned int index) const {
+  auto it = _summaries.find(procedure);
+  if (it == _summaries.end() || index >= it->second.size()) {
+    return true;
+  }
+  return it->second[index];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CallSummaryPass::buildCallGraph(const IlocProgram &prog) {
+  const auto &procedures = prog.getProcedures();
+  std::unordered_map<std::string, unsigned int> ids;
+  for (unsigned int i = 0; i < procedures.size(); i++) {
+    ids[procedures[i].getFrame().name] = i;
+  }
+
+  _callees.assign(procedures.size(), {});
+  for (unsigned int i = 0; i < procedures.size(); i++) {
+    for (const auto &block : procedures[i].orderedBlocks()) {
+      for (const auto &inst : block.instructions) {
+        if (inst.isDeleted() || !isCall(inst.operation))
+          continue;
+
+        auto it = ids.find(getCallee(inst.operation));
+        if (it != ids.end() &&
+            std::find(_callees[i].begin(), _callees[i].end(), it->second) ==
+                _callees[i].end()) {
+          _callees[i].push_back(it->second);
+        }
+      }
+    }
+  }
+}
+
+void CallSummaryPass::findComponents(unsigned int proc) {
+  _indices[proc] = _nextIndex;
+  _lowLinks[proc] = _nextIndex;
+  _nextIndex++;
+  _stack.push_back(proc);
+  _onStack[proc] = true;
+
+  for (auto callee : _callees[proc]) {
+    if (_indices[callee] == -1) {
+      findComponents(callee);
+      _lowLinks[proc] = std::min(_lowLinks[proc], _lowLinks[callee]);
+    } else if (_onStack[callee]) {
+      _lowLinks[proc] = std::min(_lowLinks[proc], _indices[callee]);
+    }
+  }
+
+  // proc is the root of a component, which is everything above it
+  if (_lowLinks[proc] == _indices[proc]) {
+    std::vector<unsigned int> component;
+    unsigned int member;
+    do {
+      member = _stack.back();
+      _stack.pop_back();
+      _onStack[member] = false;
+      component.push_back(member);
+    } while (member != proc);
+    _components.push_back(component);
+  }
+}
+
+std::vector<bool>
+CallSummaryPass::summarize(const IlocProcedure &proc) const {
+  // register names the procedure defines
+  std::unordered_set<std::string> written;
+
+  for (const auto &block : proc.orderedBlocks()) {
+    for (const auto &inst : block.instructions) {
+      if (inst.isDeleted())
+        continue;
+
+      const Operation &op = inst.operation;
+      if (!isCall(op)) {
+        for (const auto &lval : op.lvalues) {
+          if (lval.getType() == Value::Type::virtualReg) {
+            written.insert(lval.getName());
+          }
+        }
+        continue;
+      }
+
+      // the lvalues of a call may not have been narrowed yet, so go by the
+      // callee's summary instead
+      if (op.opcode != ilocParser::CALL) {
+        written.insert(op.lvalues.front().getName());
+      }
+      std::string callee = getCallee(op);
+      unsigned int index = 0;
+      for (const auto &rval : op.rvalues) {
+        if (rval.getType() != Value::Type::virtualReg)
+          continue;
+
+        if (writesArgument(callee, index)) {
+          written.insert(rval.getName());
+        }
+        index++;
+      }
+    }
+  }
+
+  const std::vector<Value> &arguments = proc.getFrame().arguments;
+  std::vector<bool> summary(arguments.size());
+  for (unsigned int i = 0; i < arguments.size(); i++) {
+    summary[i] = written.find(arguments[i].getName()) != written.end();
+  }
+  return summary;
+}
+
+void CallSummaryPass::rewriteCalls(IlocProcedure &proc) {
+  for (auto &block : proc.orderedBlocksReference()) {
+    for (auto &inst : block.instructions) {
+      if (inst.isDeleted() || !isCall(inst.operation))
+        continue;
+
+      Operation &op = inst.operation;
+      std::vector<Value> lvalues;
+      // functions with return values have one extra lvalue
+      if (op.opcode != ilocParser::CALL) {
+        lvalues.push_back(op.lvalues.front());
+      }
+
+      std::string callee = getCallee(op);
+      unsigned int index = 0;
+      for (const auto &rval : op.rvalues) {
+        if (rval.getType() != Value::Type::virtualReg)
+          continue;
+
+        if (writesArgument(callee, index)) {
+          lvalues.push_back(rval);
+        } else {
+          _unwritten++;
+        }
+        index++;
+      }
+      op.lvalues = lvalues;
+    }
+  }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pass.h"
+
+// finds which of its arguments each procedure can write back to its callers.
+// every call starts out defining all of its register arguments, since iloc is
+// call by reference. procedures are summarized bottom up over the strongly
+// connected components of the call graph, so a procedure is summarized after
+// everything it calls. the procedures of a cycle start out writing nothing and
+// are summarized again until their summaries stop growing. calls then only
+// define the arguments their callee writes, and the rest stay the same value
+// across the call.
+//
+// summaries go by register name, so this has to run before ssa.
+class CallSummaryPass : public Pass {
+public:
+  void run(IlocProgram &prog);
+  // whether a call to procedure can change its argument at index. procedures
+  // that aren't in the program can change any of them.
+  bool writesArgument(const std::string &procedure, unsigned int index) const;
+
+private:
+  void buildCallGraph(const IlocProgram &prog);
+  // tarjan's algorithm, components come out callees first
+  void findComponents(unsigned int proc);
+  std::vector<bool> summarize(const IlocProcedure &proc) const;
+  void rewriteCalls(IlocProcedure &proc);
+
+  // procedure -> procedures it calls, by position in the program
+  std::vector<std::vector<unsigned int>> _callees;
+  // procedure name -> whether it writes each of its arguments
+  std::unordered_map<std::string, std::vector<bool>> _summaries;
+
+  std::vector<std::vector<unsigned int>> _components;
+  std::vector<int> _indices;
+  std::vector<int> _lowLinks;
+  std::vector<bool> _onStack;
+  std::vector<unsigned int> _stack;
+  int _nextIndex;
+
+  unsigned int _unwritten;
+};
@@ -0,0 +1,887 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+
+#include "chordalallocationpass.h"
+
+#include "edgecopies.h"
+#include "spillcode.h"
+#include "spillcodecleaner.h"
+#include "spillslotallocator.h"
+#include "unionfind.h"
+
+ChordalAllocationPass::ChordalAllocationPass(const TargetMachine &target)
+    : _target(target) {}
+
+void ChordalAllocationPass::run(IlocProgram &prog) {
+  unsigned int iterations = 0;
+  unsigned int removedLoads = 0;
+  unsigned int removedStores = 0;
+
+  std::cerr << "performing chordal register allocation with "
+            << _target.describe() << "\n";
+
+  _offsetMap.clear();
+  _pieceMap.clear();
+  _argumentMap.clear();
+  _pieces = 0;
+  _spills = 0;
+  _copies = 0;
+  _removedMoves = 0;
+
+  LiveRangesPass lrpass(_target);
+  lrpass.run(prog);
+  _dtpass.run(prog);
+  _lnpass.run(prog);
+
+  for (const auto &proc : prog.getProcedures()) {
+    _target.checkArguments(proc);
+  }
+
+  for (auto &proc : prog.getProceduresReference()) {
+    // spill until no more values are live at once than there are registers.
+    // calls can't write back arguments their callees return over, so those
+    // go first.
+    std::vector<unsigned int> spills;
+    do {
+      iterations++;
+      const LiveRanges &ranges = lrpass.getLiveRanges(proc);
+      Values values = numberValues(proc, ranges);
+
+      spills = overwrittenRanges(proc, ranges, _target);
+      if (spills.empty()) {
+        spills = chooseSpills(proc, ranges, values);
+      }
+      if (!spills.empty()) {
+        spillRanges(proc, ranges, spills);
+        lrpass.update(proc);
+        continue;
+      }
+
+      std::vector<int> colors = colorValues(proc, ranges, values, spills);
+      if (!spills.empty()) {
+        spillRanges(proc, ranges, spills);
+        lrpass.update(proc);
+        continue;
+      }
+
+      // spilled ranges that are never live at the same time can share a slot
+      std::set<unsigned int> offsets;
+      for (const auto &pair : _offsetMap[proc.getFrame().name]) {
+        offsets.insert(pair.second);
+      }
+      SpillSlotAllocator slotAllocator(proc, offsets);
+      slotAllocator.allocate();
+
+      leaveSSA(proc, values, colors);
+
+      // once values are in registers, spill code moving a value to where it
+      // already is can go
+      SpillCodeCleaner cleaner(proc, offsets);
+      cleaner.clean();
+      removedLoads += cleaner.getRemovedLoads();
+      removedStores += cleaner.getRemovedStores();
+    } while (!spills.empty());
+  }
+
+  std::cerr << iterations << " register allocation iterations.\n";
+  std::cerr << _spills << " live ranges spilled.\n";
+  std::cerr << _copies << " copies inserted for phis.\n";
+  std::cerr << _removedMoves << " moves removed.\n";
+  std::cerr << removedLoads << " spill loads and " << removedStores
+            << " spill stores removed.\n";
+}
+
+ChordalAllocationPass::Values
+ChordalAllocationPass::numberValues(const IlocProcedure &proc,
+                                    const LiveRanges &ranges) {
+  Values values;
+  auto number = [&](const Value &value) {
+    auto it = values.numbers.find(value);
+    if (it != values.numbers.end()) {
+      return it->second;
+    }
+
+    unsigned int n = values.values.size();
+    values.numbers.insert({value, n});
+    values.values.push_back(value);
+    return n;
+  };
+
+  for (const auto &argValue : proc.getFrame().arguments) {
+    number(argValue);
+  }
+  for (const auto &block : proc.orderedBlocks()) {
+    for (const auto &phi : block.phinodes) {
+      if (phi.isDeleted())
+        continue;
+
+      number(phi.getLValue());
+      for (const auto &pair : phi.getRValueMap()) {
+        number(pair.second);
+      }
+    }
+
+    for (const auto &inst : block.instructions) {
+      if (inst.isDeleted())
+        continue;
+
+      for (const auto &rval : inst.operation.rvalues) {
+        if (rval.getType() == Value::Type::virtualReg) {
+          number(rval);
+        }
+      }
+      for (const auto &lval : inst.operation.lvalues) {
+        if (lval.getType() == Value::Type::virtualReg) {
+          number(lval);
+        }
+      }
+    }
+  }
+
+  unsigned int size = values.values.size();
+  values.pooled.assign(size, true);
+  values.fixed.assign(size, -1);
+  values.reserved.assign(_target.getTotalRegisters(), false);
+  values.partners.assign(size, {});
+
+  std::vector<TargetMachine::RegisterClass> rangeClasses =
+      _target.classifyRanges(proc, ranges);
+  for (unsigned int n = 0; n < size; n++) {
+    values.classes.push_back(
+        rangeClasses[ranges.getRangeWithValue(values.values[n]).id]);
+  }
+
+  // range id -> register every value in it keeps. the reserved integer
+  // registers are the special registers.
+  std::unordered_map<unsigned int, int> rangeRegisters;
+  for (int reg = 0; reg < static_cast<int>(_target.getReservedRegisters(
+                              TargetMachine::RegisterClass::integer));
+       reg++) {
+    values.reserved[reg] = true;
+  }
+  for (const auto &range : ranges.getRanges()) {
+    int reg = _target.getReservedRegister(range.name);
+    if (reg != -1) {
+      rangeRegisters.insert({range.id, reg});
+    }
+  }
+
+  // arguments get a register of their own. the ones that weren't spilled
+  // hold it everywhere, the spilled ones only until they're stored and once
+  // they're loaded back.
+  const std::unordered_set<Value> &spilledArguments =
+      _argumentMap[proc.getFrame().name];
+  std::map<TargetMachine::RegisterClass, unsigned int> next;
+  for (auto cls : TargetMachine::classes) {
+    next[cls] = _target.getFirstAllocatable(cls);
+  }
+  auto take = [&](TargetMachine::RegisterClass cls) {
+    if (next[cls] >= _target.getEndRegister(cls)) {
+      throw "not enough registers for the arguments of " +
+          proc.getFrame().name;
+    }
+    return static_cast<int>(next[cls]++);
+  };
+
+  for (const auto &argValue : proc.getFrame().arguments) {
+    unsigned int id = ranges.getRangeWithValue(argValue).id;
+    TargetMachine::RegisterClass cls = rangeClasses[id];
+    if (spilledArguments.find(argValue) != spilledArguments.end()) {
+      values.fixed[number(argValue)] = take(cls);
+    } else if (rangeRegisters.find(id) == rangeRegisters.end()) {
+      int reg = take(cls);
+      values.reserved[reg] = true;
+      rangeRegisters.insert({id, reg});
+    }
+  }
+
+  for (unsigned int n = 0; n < size; n++) {
+    unsigned int id = ranges.getRangeWithValue(values.values[n]).id;
+    auto it = rangeRegisters.find(id);
+    if (it != rangeRegisters.end()) {
+      values.pooled[n] = false;
+      values.fixed[n] = it->second;
+    }
+  }
+
+  // connect the values of phis and copies, and tie the lvalues of calls to
+  // their arguments
+  UnionFind classes(size);
+  auto connect = [&](unsigned int a, unsigned int b) {
+    values.partners[a].push_back(b);
+    values.partners[b].push_back(a);
+  };
+
+  for (const auto &block : proc.orderedBlocks()) {
+    for (const auto &phi : block.phinodes) {
+      if (phi.isDeleted())
+        continue;
+
+      for (const auto &pair : phi.getRValueMap()) {
+        connect(values.numbers.at(phi.getLValue()),
+                values.numbers.at(pair.second));
+      }
+    }
+
+    for (const auto &inst : block.instructions) {
+      if (inst.isDeleted())
+        continue;
+
+      const Operation &op = inst.operation;
+      if (op.opcode == ilocParser::I2I &&
+          op.rvalues.front().getType() == Value::Type::virtualReg) {
+        connect(values.numbers.at(op.lvalues.front()),
+                values.numbers.at(op.rvalues.front()));
+      }
+
+      for (const auto &pair : op.getWrittenArguments()) {
+        classes.unite(values.numbers.at(op.rvalues[pair.first]),
+                      values.numbers.at(op.lvalues[pair.second]));
+      }
+    }
+  }
+
+  values.representatives.resize(size);
+  for (unsigned int n = 0; n < size; n++) {
+    values.representatives[n] = classes.find(n);
+  }
+
+  return values;
+}
+
+SSALivenessProblem
+ChordalAllocationPass::getLiveness(const IlocProcedure &proc,
+                                   const Values &values) const {
+  BitVector exit(values.values.size());
+  for (unsigned int n = 0; n < values.values.size(); n++) {
+    if (values.pooled[n] && values.fixed[n] != -1) {
+      exit.set(n);
+    }
+  }
+  // spilled arguments the return value overwrites aren't loaded back
+  const std::vector<Value> arguments = proc.getFrame().arguments;
+  std::vector<bool> overwritten = overwrittenArguments(proc, _target);
+  for (unsigned int i = 0; i < arguments.size(); i++) {
+    if (overwritten[i]) {
+      exit.reset(values.numbers.at(arguments[i]));
+    }
+  }
+  return SSALivenessProblem(proc, values.numbers, exit);
+}
+
+std::vector<unsigned int>
+ChordalAllocationPass::chooseSpills(const IlocProcedure &proc,
+                                    const LiveRanges &ranges,
+                                    const Values &values) {
+  SSALivenessProblem problem = getLiveness(proc, values);
+  DataFlowSolver<SSALivenessProblem> solver(problem);
+  solver.solve(proc);
+
+  const std::string &name = proc.getFrame().name;
+
+  // registers of each class left over once the arguments have theirs
+  std::map<TargetMachine::RegisterClass, unsigned int> k;
+  for (auto cls : TargetMachine::classes) {
+    k[cls] = 0;
+    for (unsigned int c = _target.getFirstAllocatable(cls);
+         c < _target.getEndRegister(cls); c++) {
+      k[cls] += values.reserved[c] ? 0 : 1;
+    }
+  }
+
+  // pieces and spilled arguments are as small as they get. arguments that
+  // still hold their register are always live, spilling one helps
+  // everywhere it isn't referenced.
+  std::vector<bool> spillable(ranges.size(), false);
+  for (unsigned int n = 0; n < values.values.size(); n++) {
+    if (values.pooled[n] && values.fixed[n] == -1) {
+      spillable[ranges.getRangeWithValue(values.values[n]).id] = true;
+    }
+  }
+  const std::unordered_set<Value> &pieces = _pieceMap[name];
+  for (const auto &range : ranges.getRanges()) {
+    for (const auto &value : range.registers) {
+      if (pieces.find(value) != pieces.end()) {
+        spillable[range.id] = false;
+      }
+    }
+  }
+
+  // argument range id -> class
+  std::map<unsigned int, TargetMachine::RegisterClass> argumentRanges;
+  const std::unordered_set<Value> &spilledArguments = _argumentMap[name];
+  for (const auto &argValue : proc.getFrame().arguments) {
+    if (spilledArguments.find(argValue) == spilledArguments.end()) {
+      argumentRanges.insert({ranges.getRangeWithValue(argValue).id,
+                             values.classes[values.numbers.at(argValue)]});
+    }
+  }
+
+  // points where too much is live, with the ranges live across them
+  struct Point {
+    std::vector<unsigned int> candidates;
+    unsigned int excess;
+  };
+  std::vector<Point> points;
+  std::vector<float> weights(ranges.size(), 0.0f);
+
+  // the values of a call's argument and its lvalue share one register
+  auto pressure = [&](const BitVector &live,
+                      TargetMachine::RegisterClass cls) {
+    std::set<unsigned int> holders;
+    live.forEach([&](unsigned int n) {
+      if (values.pooled[n] && values.classes[n] == cls) {
+        holders.insert(values.representatives[n]);
+      }
+    });
+    return holders.size();
+  };
+
+  // spilling a range frees its register wherever the range isn't referenced.
+  // at an instruction, it's still loaded for the rvalues and stored from the
+  // lvalues, but a range read there needn't be live after it, or one written
+  // there before it.
+  auto addPoint = [&](const BitVector &live,
+                      const std::set<unsigned int> &referenced,
+                      TargetMachine::RegisterClass cls, unsigned int count) {
+    if (count <= k[cls])
+      return;
+
+    std::set<unsigned int> candidates;
+    live.forEach([&](unsigned int n) {
+      unsigned int id = ranges.getRangeWithValue(values.values[n]).id;
+      if (values.pooled[n] && values.classes[n] == cls && spillable[id] &&
+          referenced.find(id) == referenced.end()) {
+        candidates.insert(id);
+      }
+    });
+    for (const auto &pair : argumentRanges) {
+      if (pair.second == cls &&
+          referenced.find(pair.first) == referenced.end()) {
+        candidates.insert(pair.first);
+      }
+    }
+
+    points.push_back({{candidates.begin(), candidates.end()}, count - k[cls]});
+  };
+
+  const std::vector<unsigned int> &depths = _lnpass.getLoopDepths(proc);
+  for (const auto &block : proc.orderedBlocks()) {
+    // a reference in a loop is assumed to run ten times as often as one
+    // outside of it
+    float weight = std::pow(10.0f, static_cast<float>(depths[block.id]));
+
+    BitVector live = solver.getOut(block.id);
+    problem.addPhiOperands(block, live);
+
+    for (auto it = block.instructions.rbegin();
+         it != block.instructions.rend(); it++) {
+      if (it->isDeleted())
+        continue;
+
+      std::set<unsigned int> defined;
+      BitVector after = live;
+      for (const auto &lval : it->operation.lvalues) {
+        if (lval.getType() == Value::Type::virtualReg) {
+          const LiveRange &range = ranges.getRangeWithValue(lval);
+          weights[range.id] += range.remat ? 0.0f : weight;
+          defined.insert(range.id);
+
+          unsigned int n = values.numbers.at(lval);
+          after.set(n);
+          live.reset(n);
+        }
+      }
+      std::set<unsigned int> used;
+      for (const auto &rval : it->operation.rvalues) {
+        if (rval.getType() == Value::Type::virtualReg) {
+          const LiveRange &range = ranges.getRangeWithValue(rval);
+          weights[range.id] += weight;
+          used.insert(range.id);
+          live.set(values.numbers.at(rval));
+        }
+      }
+
+      for (auto cls : TargetMachine::classes) {
+        addPoint(after, defined, cls, pressure(after, cls));
+        addPoint(live, used, cls, pressure(live, cls));
+      }
+    }
+
+    // phis are all defined at the top of the block
+    for (const auto &phi : block.phinodes) {
+      if (!phi.isDeleted()) {
+        live.set(values.numbers.at(phi.getLValue()));
+      }
+    }
+    for (auto cls : TargetMachine::classes) {
+      addPoint(live, {}, cls, pressure(live, cls));
+    }
+  }
+
+  // every point needs as many of its candidates spilled as it is over. the
+  // range that is cheapest for the number of points it still helps goes
+  // first, until no point is over.
+  std::vector<std::vector<unsigned int>> pointsOf(ranges.size());
+  std::vector<unsigned int> excess(points.size());
+  for (unsigned int p = 0; p < points.size(); p++) {
+    excess[p] = points[p].excess;
+    for (auto id : points[p].candidates) {
+      pointsOf[id].push_back(p);
+    }
+  }
+
+  std::vector<unsigned int> spills;
+  std::vector<bool> chosen(ranges.size(), false);
+  while (std::any_of(excess.begin(), excess.end(),
+                     [](unsigned int e) { return e > 0; })) {
+    int best = -1;
+    unsigned int bestBenefit = 0;
+    for (unsigned int id = 0; id < ranges.size(); id++) {
+      unsigned int benefit = std::count_if(
+          pointsOf[id].begin(), pointsOf[id].end(),
+          [&](unsigned int p) { return excess[p] > 0; });
+      if (chosen[id] || benefit == 0)
+        continue;
+
+      float cost = weights[id] * bestBenefit;
+      float bestCost = best == -1 ? 0.0f : weights[best] * benefit;
+      if (best == -1 || cost < bestCost ||
+          (cost == bestCost && benefit > bestBenefit)) {
+        best = id;
+        bestBenefit = benefit;
+      }
+    }
+
+    // what's left over is read or written by the instruction itself
+    if (best == -1) {
+      throw "an instruction in " + name +
+          " references more values than there are registers";
+    }
+
+    chosen[best] = true;
+    spills.push_back(best);
+    for (auto p : pointsOf[best]) {
+      if (excess[p] > 0) {
+        excess[p]--;
+      }
+    }
+  }
+
+  return spills;
+}
+
+void ChordalAllocationPass::spillRanges(IlocProcedure &proc,
+                                        const LiveRanges &ranges,
+                                        const std::vector<unsigned int> &ids) {
+  // range id -> stack offset. rematerialized ranges don't need one.
+  std::unordered_map<unsigned int, unsigned int> offsets;
+  for (auto id : ids) {
+    const LiveRange &range = ranges.getRange(id);
+    if (!range.remat) {
+      offsets[id] = growFrame(proc);
+      _offsetMap[proc.getFrame().name][range.name] = offsets[id];
+    }
+    _spills++;
+  }
+
+  spillLiveRanges(proc, ranges, ids, offsets, _pieceMap[proc.getFrame().name],
+                  _pieces, _target);
+
+  // the values of a spilled range meet in its stack slot, so its phis have
+  // nothing left to do
+  std::unordered_set<unsigned int> spilled(ids.begin(), ids.end());
+  for (auto &block : proc.orderedBlocksReference()) {
+    for (auto &phi : block.phinodes) {
+      if (!phi.isDeleted() &&
+          spilled.find(ranges.getRangeWithValue(phi.getLValue()).id) !=
+              spilled.end()) {
+        phi.markAsDeleted();
+      }
+    }
+  }
+
+  for (const auto &argValue : proc.getFrame().arguments) {
+    unsigned int id = ranges.getRangeWithValue(argValue).id;
+    if (spilled.find(id) != spilled.end()) {
+      spillArgument(proc, argValue, offsets.at(id), _target);
+      _argumentMap[proc.getFrame().name].insert(argValue);
+    }
+  }
+}
+
+std::vector<int>
+ChordalAllocationPass::colorValues(const IlocProcedure &proc,
+                                   const LiveRanges &ranges,
+                                   const Values &values,
+                                   std::vector<unsigned int> &spills) {
+  SSALivenessProblem problem = getLiveness(proc, values);
+  DataFlowSolver<SSALivenessProblem> solver(problem);
+  solver.solve(proc);
+
+  const std::string &name = proc.getFrame().name;
+  const std::unordered_set<Value> &pieces = _pieceMap[name];
+  unsigned int size = values.values.size();
+
+  // values with a fixed register that still compete for it, the spilled
+  // arguments. nothing live at the same time can take their register.
+  std::vector<unsigned int> fixedValues;
+  for (unsigned int n = 0; n < size; n++) {
+    if (values.pooled[n] && values.fixed[n] != -1) {
+      fixedValues.push_back(n);
+    }
+  }
+
+  unsigned int registers = _target.getTotalRegisters();
+  std::vector<std::vector<bool>> forbidden(size,
+                                           std::vector<bool>(registers, false));
+  auto forbid = [&](const BitVector &live) {
+    for (auto f : fixedValues) {
+      if (live.test(f)) {
+        live.forEach([&](unsigned int n) {
+          if (n != f) {
+            forbidden[values.representatives[n]][values.fixed[f]] = true;
+          }
+        });
+      }
+    }
+  };
+
+  if (!fixedValues.empty()) {
+    for (const auto &block : proc.orderedBlocks()) {
+      BitVector live = solver.getOut(block.id);
+      problem.addPhiOperands(block, live);
+      forbid(live);
+
+      for (auto it = block.instructions.rbegin();
+           it != block.instructions.rend(); it++) {
+        if (it->isDeleted())
+          continue;
+
+        for (const auto &lval : it->operation.lvalues) {
+          if (lval.getType() == Value::Type::virtualReg) {
+            live.set(values.numbers.at(lval));
+          }
+        }
+        forbid(live);
+        for (const auto &lval : it->operation.lvalues) {
+          if (lval.getType() == Value::Type::virtualReg) {
+            live.reset(values.numbers.at(lval));
+          }
+        }
+        for (const auto &rval : it->operation.rvalues) {
+          if (rval.getType() == Value::Type::virtualReg) {
+            live.set(values.numbers.at(rval));
+          }
+        }
+        forbid(live);
+      }
+    }
+  }
+
+  std::vector<int> colors = values.fixed;
+  // representative -> register of its values
+  std::vector<int> shared(size, -1);
+  std::vector<bool> inUse(registers, false);
+  // a register stays in use while any value of its representative is live
+  std::vector<bool> holding(size, false);
+  std::vector<unsigned int> holders(size, 0);
+
+  auto acquire = [&](unsigned int n) {
+    unsigned int rep = values.representatives[n];
+    if (!values.pooled[n] || holding[n])
+      return;
+
+    holding[n] = true;
+    if (holders[rep]++ > 0) {
+      colors[n] = shared[rep];
+      return;
+    }
+
+    TargetMachine::RegisterClass cls = values.classes[n];
+    int color = colors[n] != -1 ? colors[n] : shared[rep];
+    if (color == -1) {
+      // the register of a value it is connected to saves a copy
+      for (auto partner : values.partners[n]) {
+        int c = colors[partner];
+        if (_target.isAllocatable(cls, c) && !inUse[c] &&
+            !values.reserved[c] && !forbidden[rep][c]) {
+          color = c;
+          break;
+        }
+      }
+      for (unsigned int c = _target.getFirstAllocatable(cls);
+           c < _target.getEndRegister(cls) && color == -1; c++) {
+        if (!inUse[c] && !values.reserved[c] && !forbidden[rep][c]) {
+          color = c;
+        }
+      }
+      if (color == -1 && pieces.find(values.values[n]) == pieces.end() &&
+          values.fixed[n] == -1) {
+        // spilling the range splits it where the registers are fixed
+        unsigned int id = ranges.getRangeWithValue(values.values[n]).id;
+        if (std::find(spills.begin(), spills.end(), id) == spills.end()) {
+          spills.push_back(id);
+        }
+        holding[n] = false;
+        holders[rep]--;
+        return;
+      }
+      if (color == -1) {
+        throw "ran out of registers for " + values.values[n].getFullText() +
+            " in " + name;
+      }
+    } else if (inUse[color]) {
+      throw "the register of " + values.values[n].getFullText() + " in " +
+          name + " is taken";
+    }
+
+    colors[n] = color;
+    shared[rep] = color;
+    inUse[color] = true;
+  };
+
+  auto release = [&](unsigned int n) {
+    unsigned int rep = values.representatives[n];
+    if (!holding[n])
+      return;
+
+    holding[n] = false;
+    if (--holders[rep] == 0) {
+      inUse[colors[n]] = false;
+    }
+  };
+
+  // a value is defined in a block that dominates everything it's live in, so
+  // the values live into a block already have their registers
+  const DominatorTree &tree = _dtpass.getDominatorTree(proc);
+  for (auto id : tree.getPreorder()) {
+    const BasicBlock &block = proc.getBlock(id);
+    unsigned int count = block.instructions.size();
+
+    // walk backwards to find the instruction each value dies at
+    std::vector<std::vector<unsigned int>> dying(count);
+    std::vector<std::vector<unsigned int>> unused(count);
+    BitVector live = solver.getOut(id);
+    problem.addPhiOperands(block, live);
+
+    for (int i = count - 1; i >= 0; i--) {
+      const Instruction &inst = block.instructions[i];
+      if (inst.isDeleted())
+        continue;
+
+      for (const auto &lval : inst.operation.lvalues) {
+        if (lval.getType() == Value::Type::virtualReg) {
+          unsigned int n = values.numbers.at(lval);
+          if (!live.test(n)) {
+            unused[i].push_back(n);
+          }
+          live.reset(n);
+        }
+      }
+      for (const auto &rval : inst.operation.rvalues) {
+        if (rval.getType() == Value::Type::virtualReg) {
+          unsigned int n = values.numbers.at(rval);
+          if (!live.test(n)) {
+            dying[i].push_back(n);
+            live.set(n);
+          }
+        }
+      }
+    }
+
+    std::fill(inUse.begin(), inUse.end(), false);
+    std::fill(holding.begin(), holding.end(), false);
+    std::fill(holders.begin(), holders.end(), 0);
+    const BitVector &in = solver.getIn(id);
+    in.forEach([&](unsigned int n) {
+      if (colors[n] != -1) {
+        acquire(n);
+      }
+    });
+    // values read before any definition come in uninitialized at the entry
+    in.forEach([&](unsigned int n) {
+      if (colors[n] == -1) {
+        acquire(n);
+      }
+    });
+
+    for (const auto &phi : block.phinodes) {
+      if (!phi.isDeleted()) {
+        acquire(values.numbers.at(phi.getLValue()));
+      }
+    }
+    for (const auto &phi : block.phinodes) {
+      if (!phi.isDeleted() && !live.test(values.numbers.at(phi.getLValue()))) {
+        release(values.numbers.at(phi.getLValue()));
+      }
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+      const Instruction &inst = block.instructions[i];
+      if (inst.isDeleted())
+        continue;
+
+      for (auto n : dying[i]) {
+        release(n);
+      }
+
+      // lvalues that go back into the register of an argument come first,
+      // before another lvalue can take it. the return value is written after
+      // them, so it can take the register of one nobody reads.
+      std::vector<unsigned int> definitions;
+      for (const auto &lval : inst.operation.lvalues) {
+        if (lval.getType() == Value::Type::virtualReg) {
+          definitions.push_back(values.numbers.at(lval));
+        }
+      }
+      auto rest = std::stable_partition(
+          definitions.begin(), definitions.end(), [&](unsigned int n) {
+            return colors[n] != -1 || shared[values.representatives[n]] != -1;
+          });
+      for (auto d = definitions.begin(); d != rest; d++) {
+        acquire(*d);
+      }
+      for (auto n : unused[i]) {
+        if (std::find(definitions.begin(), rest, n) != rest) {
+          release(n);
+        }
+      }
+      for (auto d = rest; d != definitions.end(); d++) {
+        acquire(*d);
+      }
+      for (auto n : unused[i]) {
+        release(n);
+      }
+    }
+  }
+
+  return colors;
+}
+
+void ChordalAllocationPass::leaveSSA(IlocProcedure &proc,
+                                     const Values &values,
+                                     const std::vector<int> &colors) {
+  SSALivenessProblem problem = getLiveness(proc, values);
+  DataFlowSolver<SSALivenessProblem> solver(problem);
+  solver.solve(proc);
+
+  auto registerName = [](int color) { return "%vr" + std::to_string(color); };
+
+  EdgeCopies edges;
+  int slot = -1;
+  auto findSlot = [&]() {
+    if (slot == -1) {
+      slot = growFrame(proc);
+    }
+    return static_cast<unsigned int>(slot);
+  };
+
+  for (const auto &block : proc.orderedBlocks()) {
+    for (auto predId : block.before) {
+      if (!proc.takesEdge(predId, block.id))
+        continue;
+
+      EdgeCopies::ParallelCopies pending;
+      for (const auto &phi : block.phinodes) {
+        if (phi.isDeleted())
+          continue;
+
+        unsigned int n = values.numbers.at(phi.getLValue());
+        auto it = phi.getRValueMap().find(predId);
+        if (!values.pooled[n] || it == phi.getRValueMap().end())
+          continue;
+
+        int from = colors[values.numbers.at(it->second)];
+        if (from != -1 && from != colors[n]) {
+          pending[registerName(colors[n])] = registerName(from);
+        }
+      }
+
+      if (pending.empty())
+        continue;
+
+      // a register of the same class that nothing on the edge needs can hold
+      // a value while a cycle of copies is broken up
+      std::vector<bool> busy = values.reserved;
+      solver.getIn(block.id).forEach([&](unsigned int n) {
+        if (colors[n] != -1) {
+          busy[colors[n]] = true;
+        }
+      });
+      for (const auto &pair : pending) {
+        busy[std::stoi(pair.first.substr(3))] = true;
+        busy[std::stoi(pair.second.substr(3))] = true;
+      }
+      // phis whose value is already in place aren't pending, but their
+      // register is taken all the same
+      for (const auto &phi : block.phinodes) {
+        int color = phi.isDeleted()
+                        ? -1
+                        : colors[values.numbers.at(phi.getLValue())];
+        if (color != -1) {
+          busy[color] = true;
+        }
+      }
+      auto findTemp = [&](const std::string &reg) -> std::string {
+        TargetMachine::RegisterClass cls =
+            _target.getRegisterClass(std::stoi(reg.substr(3)));
+        for (unsigned int c = _target.getFirstAllocatable(cls);
+             c < _target.getEndRegister(cls); c++) {
+          if (!busy[c]) {
+            return registerName(c);
+          }
+        }
+        return "";
+      };
+
+      _copies += edges.add(proc, predId, block.id, pending, findTemp, findSlot);
+    }
+  }
+
+  // convert values to their registers
+  auto remap = [&](Value &value) {
+    auto it = values.numbers.find(value);
+    if (value.getType() != Value::Type::virtualReg ||
+        it == values.numbers.end())
+      return;
+
+    value.setSubscript(value.getFullText());
+    value.setName(registerName(colors[it->second]));
+  };
+
+  for (auto &arg : proc.getFrameReference().arguments) {
+    remap(arg);
+  }
+
+  for (auto &block : proc.orderedBlocksReference()) {
+    for (auto &inst : block.instructions) {
+      if (inst.isDeleted())
+        continue;
+
+      for (auto &lval : inst.operation.lvalues) {
+        remap(lval);
+      }
+      for (auto &rval : inst.operation.rvalues) {
+        remap(rval);
+      }
+
+      // copies between values that ended up in the same register do nothing
+      if (inst.operation.opcode == ilocParser::I2I && inst.label == "" &&
+          inst.operation.rvalues.front().getName() ==
+              inst.operation.lvalues.front().getName()) {
+        inst.markAsDeleted();
+        _removedMoves++;
+      }
+    }
+
+    // the copies take the place of the phis
+    for (auto &phi : block.phinodes) {
+      phi.markAsDeleted();
+    }
+  }
+
+  edges.insert(proc);
+}
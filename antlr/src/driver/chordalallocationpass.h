@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "dominatortreepass.h"
+#include "liverangespass.h"
+#include "loopnestingpass.h"
+#include "pass.h"
+#include "ssalivenessproblem.h"
+#include "targetmachine.h"
+
+// register allocation on the ssa form itself. the interference graph of a
+// strict ssa program is chordal, so once no more than k values are live at
+// any point, coloring the values in dominator tree preorder never runs out of
+// registers, and the graph never has to be built. the pass spills until the
+// register pressure fits, colors each ssa value on its own, then leaves ssa by
+// turning the phis into copies on the edges into their blocks. values try to
+// take the register of the phis and copies they are connected to, so most of
+// those copies end up moving a register to itself and go away.
+//
+// registers fixed in place by arguments break that guarantee, so a value that
+// still finds no register has its range spilled as well, and the procedure
+// is allocated again.
+//
+// spilling still works on the live ranges of LiveRangesPass. a spilled range
+// keeps all of its values in one stack slot, which takes the place of its
+// phis. arguments keep one register for the whole procedure, as in the other
+// allocators, except that the last ones are left to the return value once
+// they're spilled (see spillcode.h). each register class has its own
+// pressure and registers.
+class ChordalAllocationPass : public Pass {
+public:
+  ChordalAllocationPass(const TargetMachine &target);
+  void run(IlocProgram &prog);
+
+private:
+  // the ssa values of a procedure, numbered densely, and what constrains
+  // their registers
+  struct Values {
+    std::vector<Value> values;
+    std::unordered_map<Value, unsigned int> numbers;
+    // values competing for the allocatable registers. the special registers
+    // and the ranges of arguments that weren't spilled keep their register
+    // everywhere, so they're left out.
+    std::vector<bool> pooled;
+    // register a value has to get, -1 if any will do
+    std::vector<int> fixed;
+    std::vector<TargetMachine::RegisterClass> classes;
+    // registers held for the whole procedure
+    std::vector<bool> reserved;
+    // values connected by a phi or a copy, which would like to share a
+    // register
+    std::vector<std::vector<unsigned int>> partners;
+    // call by reference leaves the lvalues of a call in the registers of
+    // their arguments, so they share a representative
+    std::vector<unsigned int> representatives;
+  };
+
+  Values numberValues(const IlocProcedure &proc, const LiveRanges &ranges);
+  // liveness of the values. spilled arguments are loaded back into their
+  // registers on the way to the exit, and have to stay there.
+  SSALivenessProblem getLiveness(const IlocProcedure &proc,
+                                 const Values &values) const;
+  std::vector<unsigned int> chooseSpills(const IlocProcedure &proc,
+                                         const LiveRanges &ranges,
+                                         const Values &values);
+  void spillRanges(IlocProcedure &proc, const LiveRanges &ranges,
+                   const std::vector<unsigned int> &ids);
+  // registers of the values. fixed registers can still leave a value
+  // without one, the ranges of those are added to spills.
+  std::vector<int> colorValues(const IlocProcedure &proc,
+                               const LiveRanges &ranges, const Values &values,
+                               std::vector<unsigned int> &spills);
+  void leaveSSA(IlocProcedure &proc, const Values &values,
+                const std::vector<int> &colors);
+
+  const TargetMachine &_target;
+  DominatorTreePass _dtpass;
+  LoopNestingPass _lnpass;
+
+  // procedure name -> live range name -> stack offset
+  std::unordered_map<std::string, std::unordered_map<std::string, unsigned int>>
+      _offsetMap;
+  // procedure name -> values that were split off of spilled ranges. they
+  // are as small as they can get, so they can't be spilled again.
+  std::unordered_map<std::string, std::unordered_set<Value>> _pieceMap;
+  // procedure name -> arguments that were spilled
+  std::unordered_map<std::string, std::unordered_set<Value>> _argumentMap;
+  unsigned int _pieces;
+  unsigned int _spills;
+  unsigned int _copies;
+  unsigned int _removedMoves;
+};
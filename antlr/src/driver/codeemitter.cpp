@@ -217,13 +217,19 @@ std::string CodeEmitter::storeInstText(const Instruction &inst) const {
   // store instructions are tricky. they don't really have any "lvalues", but
   // must be printed as if they do.
 
-  std::string text = tab;
+  std::string text;
 
   // show deleted
   if (inst.isDeleted() == true) {
     text += "(deleted)";
   }
 
+  if (inst.label != "") {
+    text += inst.label + ": ";
+  } else {
+    text += tab;
+  }
+
   // vocabulary returns name with quotes, trim them
   std::string opName = vocab.getDisplayName(inst.operation.opcode);
   opName = opName.substr(1, opName.length() - 2);
@@ -247,13 +253,19 @@ std::string CodeEmitter::storeInstText(const Instruction &inst) const {
 std::string CodeEmitter::callInstText(const Instruction &inst) const {
   // to the interpreter, the "lvalues" of a call instruction are implicit
   // because of call by reference
-  std::string text = tab;
+  std::string text;
 
   // show deleted
   if (inst.isDeleted() == true) {
     text += "(deleted)";
   }
 
+  if (inst.label != "") {
+    text += inst.label + ": ";
+  } else {
+    text += tab;
+  }
+
   // vocabulary returns name with quotes, trim them
   std::string opName = vocab.getDisplayName(inst.operation.opcode);
   opName = opName.substr(1, opName.length() - 2);
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "ilocprocedure.h"
+
+// iterative solver for dataflow problems over the blocks of a procedure.
+//
+// a problem describes its analysis with:
+//   Lattice                   the per block value, e.g. a BitVector
+//   Summary                   local info about a block, computed once
+//   static const DataFlowDirection direction
+//   Summary summarize(const BasicBlock &block)
+//   Lattice top()             starting value, identity of meet
+//   Lattice boundary()        value flowing into entry (forward) or out of
+//                             blocks without successors (backward)
+//   void meet(Lattice &into, const Lattice &from)
+//   bool transfer(const Summary &summary, const Lattice &input,
+//                 Lattice &output)   returns true if output changed
+//
+// results are given in program order: getIn is the value at the top of a
+// block and getOut the value at the bottom, whichever way the problem flows.
+enum class DataFlowDirection { forward, backward };
+
+template <typename Problem> class DataFlowSolver {
+public:
+  using Lattice = typename Problem::Lattice;
+  using Summary = typename Problem::Summary;
+
+  DataFlowSolver(Problem &problem);
+  void solve(const IlocProcedure &proc);
+
+  const Lattice &getIn(unsigned int block) const;
+  const Lattice &getOut(unsigned int block) const;
+  const Summary &getSummary(unsigned int block) const;
+  // number of times a transfer function was applied in the last solve
+  unsigned int getIterations() const;
+
+private:
+  static const bool forward =
+      Problem::direction == DataFlowDirection::forward;
+
+  void computeOrder(const IlocProcedure &proc);
+  const std::vector<unsigned int> &edgesInto(const BasicBlock &block) const;
+  const std::vector<unsigned int> &edgesOutOf(const BasicBlock &block) const;
+
+  Problem &_problem;
+  std::vector<Summary> _summaries;
+  // meet of the values flowing into each block, and the transfer result
+  std::vector<Lattice> _input;
+  std::vector<Lattice> _output;
+  // position of each block in the visiting order, none if unreachable
+  std::vector<unsigned int> _rank;
+  std::vector<unsigned int> _order;
+  unsigned int _iterations = 0;
+
+  static const unsigned int none = std::numeric_limits<unsigned int>::max();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename Problem> const unsigned int DataFlowSolver<Problem>::none;
+
+template <typename Problem>
+DataFlowSolver<Problem>::DataFlowSolver(Problem &problem)
+    : _problem(problem) {}
+
+template <typename Problem>
+void DataFlowSolver<Problem>::solve(const IlocProcedure &proc) {
+  const IlocProcedure::BlockList &blocks = proc.orderedBlocks();
+
+  // local summaries only depend on the block, compute them once
+  _summaries.clear();
+  _summaries.reserve(blocks.size());
+  for (const auto &block : blocks) {
+    _summaries.push_back(_problem.summarize(block));
+  }
+  _input.assign(blocks.size(), _problem.top());
+  _output.assign(blocks.size(), _problem.top());
+
+  computeOrder(proc);
+
+  // always pull the earliest block in the order, so a block is usually
+  // evaluated after everything flowing into it
+  std::priority_queue<unsigned int, std::vector<unsigned int>,
+                      std::greater<unsigned int>>
+      worklist;
+  std::vector<bool> onWorklist(blocks.size(), false);
+  for (unsigned int rank = 0; rank < _order.size(); rank++) {
+    worklist.push(rank);
+    onWorklist[_order[rank]] = true;
+  }
+
+  _iterations = 0;
+  while (!worklist.empty()) {
+    unsigned int id = _order[worklist.top()];
+    worklist.pop();
+    onWorklist[id] = false;
+    _iterations++;
+
+    const BasicBlock &block = blocks[id];
+    const std::vector<unsigned int> &sources = edgesInto(block);
+    if (sources.empty()) {
+      _input[id] = _problem.boundary();
+    } else {
+      _input[id] = _problem.top();
+      for (auto source : sources) {
+        _problem.meet(_input[id], _output[source]);
+      }
+    }
+
+    if (_problem.transfer(_summaries[id], _input[id], _output[id])) {
+      for (auto target : edgesOutOf(block)) {
+        if (_rank[target] != none && !onWorklist[target]) {
+          worklist.push(_rank[target]);
+          onWorklist[target] = true;
+        }
+      }
+    }
+  }
+}
+
+template <typename Problem>
+const typename DataFlowSolver<Problem>::Lattice &
+DataFlowSolver<Problem>::getIn(unsigned int block) const {
+  return forward ? _input.at(block) : _output.at(block);
+}
+
+template <typename Problem>
+const typename DataFlowSolver<Problem>::Lattice &
+DataFlowSolver<Problem>::getOut(unsigned int block) const {
+  return forward ? _output.at(block) : _input.at(block);
+}
+
+template <typename Problem>
+const typename DataFlowSolver<Problem>::Summary &
+DataFlowSolver<Problem>::getSummary(unsigned int block) const {
+  return _summaries.at(block);
+}
+
+template <typename Problem>
+unsigned int DataFlowSolver<Problem>::getIterations() const {
+  return _iterations;
+}
+
+template <typename Problem>
+void DataFlowSolver<Problem>::computeOrder(const IlocProcedure &proc) {
+  const IlocProcedure::BlockList &blocks = proc.orderedBlocks();
+
+  // postorder of the cfg from entry
+  std::vector<unsigned int> postorder;
+  std::vector<bool> visited(blocks.size(), false);
+  std::vector<std::pair<unsigned int, unsigned int>> stack;
+  unsigned int entryId = proc.getBlockId("entry");
+  stack.push_back({entryId, 0});
+  visited[entryId] = true;
+
+  while (!stack.empty()) {
+    unsigned int id = stack.back().first;
+    unsigned int next = stack.back().second++;
+
+    if (next < blocks[id].after.size()) {
+      unsigned int succ = blocks[id].after[next];
+      if (!visited[succ]) {
+        visited[succ] = true;
+        stack.push_back({succ, 0});
+      }
+    } else {
+      postorder.push_back(id);
+      stack.pop_back();
+    }
+  }
+
+  // forward problems visit in reverse postorder, so predecessors come
+  // first. backward problems visit in postorder, so successors come first.
+  _order = postorder;
+  if (forward) {
+    _order.assign(postorder.rbegin(), postorder.rend());
+  }
+
+  _rank.assign(blocks.size(), none);
+  for (unsigned int rank = 0; rank < _order.size(); rank++) {
+    _rank[_order[rank]] = rank;
+  }
+}
+
+template <typename Problem>
+const std::vector<unsigned int> &
+DataFlowSolver<Problem>::edgesInto(const BasicBlock &block) const {
+  return forward ? block.before : block.after;
+}
+
+template <typename Problem>
+const std::vector<unsigned int> &
+DataFlowSolver<Problem>::edgesOutOf(const BasicBlock &block) const {
+  return forward ? block.after : block.before;
+}
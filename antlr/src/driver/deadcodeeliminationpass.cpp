@@ -6,17 +6,15 @@
 DeadCodeEliminationPass::DeadCodeEliminationPass()
     : PDTreePass(DominatorTreePass::Mode::postdominator) {}
 
-IlocProgram DeadCodeEliminationPass::applyToProgram(IlocProgram prog) {
+void DeadCodeEliminationPass::run(IlocProgram &prog) {
   std::cerr << "eliminating dead code\n";
   UsesAndDefinitionsPass ssaInfoPass;
-  prog = ssaInfoPass.applyToProgram(prog);
-  PDTreePass.applyToProgram(prog);
+  ssaInfoPass.run(prog);
+  PDTreePass.run(prog);
 
   for (auto &proc : prog.getProceduresReference()) {
     eliminateDeadCode(proc);
   }
-
-  return prog;
 }
 
 void DeadCodeEliminationPass::eliminateDeadCode(IlocProcedure &proc) {
@@ -29,9 +27,8 @@ void DeadCodeEliminationPass::eliminateDeadCode(IlocProcedure &proc) {
   _phiNecessary.clear();
 
   // put side effect instructions in the work list
-  for (auto blockCopy : proc.orderedBlocks()) {
-    BasicBlock &block = proc.getBlockReference(blockCopy.debugName);
-    for (auto &inst : block.instructions) {
+  for (const auto &block : proc.orderedBlocks()) {
+    for (const auto &inst : block.instructions) {
       if (inst.hasPossibleSideEffects()) {
         if (std::find(_instWorklist.begin(), _instWorklist.end(), inst) ==
             _instWorklist.end()) {
@@ -42,7 +39,7 @@ void DeadCodeEliminationPass::eliminateDeadCode(IlocProcedure &proc) {
     }
   }
 
-  DominanceFrontiers PDFrontiers(PDTreePass.getDominatorTree(proc),
+  DominanceFrontiers PDFrontiers(proc, PDTreePass.getDominatorTree(proc),
                                  DominanceFrontiers::Mode::postdominator);
   // PDFrontiers.dump();
 
@@ -55,10 +52,11 @@ void DeadCodeEliminationPass::eliminateDeadCode(IlocProcedure &proc) {
       _instWorklist.erase(_instWorklist.begin());
       _instVisited.insert(instCopy);
 
-      BasicBlock block = proc.getBlock(getContainingBlockName(instCopy, proc));
+      const BasicBlock &block =
+          proc.getBlock(getContainingBlock(instCopy, proc));
 
       // branches to necessary instructions are necessary
-      addBranchesToBlock(block, PDFrontiers);
+      addBranchesToBlock(block, PDFrontiers, proc);
 
       // definitions of necessary rvalues are necessary
       for (auto rvalue : getRValuesFrom(instCopy)) {
@@ -73,10 +71,11 @@ void DeadCodeEliminationPass::eliminateDeadCode(IlocProcedure &proc) {
       _phiWorkList.erase(_phiWorkList.begin());
       _phiVisited.insert(phiCopy);
 
-      BasicBlock block = proc.getBlock(getContainingBlockName(phiCopy, proc));
+      const BasicBlock &block =
+          proc.getBlock(getContainingBlock(phiCopy, proc));
 
       // contidtional branches to necessary instructions are necessary
-      addBranchesToBlock(block, PDFrontiers);
+      addBranchesToBlock(block, PDFrontiers, proc);
 
       // definitions of necessary rvalues are necessary
       for (auto rvalue : getRValuesFrom(phiCopy)) {
@@ -86,9 +85,7 @@ void DeadCodeEliminationPass::eliminateDeadCode(IlocProcedure &proc) {
   }
 
   // remove unecessary
-  for (auto blockCopy : proc.orderedBlocks()) {
-    BasicBlock &block = proc.getBlockReference(blockCopy.debugName);
-
+  for (auto &block : proc.orderedBlocksReference()) {
     // instructions
     for (auto &inst : block.instructions) {
       if (_instNecessary.find(inst) == _instNecessary.end()) {
@@ -96,12 +93,13 @@ void DeadCodeEliminationPass::eliminateDeadCode(IlocProcedure &proc) {
         if (inst.operation.category == Operation::Category::branch &&
             inst.operation.opcode != ilocParser::JUMP &&
             inst.operation.opcode != ilocParser::JUMPI) {
-          Value lval = inst.operation.lvalues.front();
-          DominatorTree tree = PDTreePass.getDominatorTree(proc);
-          std::string newName = PDTreePass.getDominatorTree(proc)
-                                    .findParentOf(block.debugName)
-                                    .getBasicBlock()
-                                    .debugName;
+          unsigned int postdominator =
+              PDTreePass.getDominatorTree(proc).getParent(block.id);
+          if (postdominator == DominatorTree::none) {
+            // never reaches the exit, leave it alone
+            continue;
+          }
+          std::string newName = proc.getBlock(postdominator).debugName;
 
           Operation newOp(ilocParser::JUMPI);
           newOp.arrow = "->";
@@ -137,24 +135,17 @@ std::vector<Value> DeadCodeEliminationPass::getRValuesFrom(const PhiNode &phi) {
   return r;
 }
 
-std::string
-DeadCodeEliminationPass::getContainingBlockName(const Instruction &inst,
-                                                const IlocProcedure &proc) {
-  return inst.containingBlockName;
+unsigned int
+DeadCodeEliminationPass::getContainingBlock(const Instruction &inst,
+                                            const IlocProcedure &proc) {
+  return inst.containingBlock;
 }
 
-std::string
-DeadCodeEliminationPass::getContainingBlockName(const PhiNode &phi,
-                                                const IlocProcedure &proc) {
-  for (auto block : proc.orderedBlocks()) {
-    for (auto lookphi : block.phinodes) {
-      if (phi == lookphi)
-        return block.debugName;
-    }
-  }
-
-  throw "uh oh";
-  return "not good";
+unsigned int
+DeadCodeEliminationPass::getContainingBlock(const PhiNode &phi,
+                                            const IlocProcedure &proc) {
+  // phi nodes define their lvalue, so the definition records the block
+  return proc.getSSAInfo().definitionsMap.at(phi.getLValue())->containingBlock;
 }
 
 void DeadCodeEliminationPass::addDefinitionOfRValue(Value r,
@@ -191,9 +182,11 @@ void DeadCodeEliminationPass::addDefinitionOfRValue(Value r,
 }
 
 void DeadCodeEliminationPass::addBranchesToBlock(
-    const BasicBlock &block, const DominanceFrontiers &PDF) {
+    const BasicBlock &block, const DominanceFrontiers &PDF,
+    const IlocProcedure &proc) {
   // condinitional branches to necessary instructions are necessary
-  for (auto controlDepBlock : PDF.getDominanceFrontier(block)) {
+  for (auto controlDepId : PDF.getDominanceFrontier(block.id)) {
+    const BasicBlock &controlDepBlock = proc.getBlock(controlDepId);
     Instruction lastInst = controlDepBlock.instructions.back();
     Operation::Category opCat = lastInst.operation.category;
     unsigned int opCode = lastInst.operation.opcode;
@@ -202,9 +195,10 @@ void DeadCodeEliminationPass::addBranchesToBlock(
         opCode != ilocParser::JUMPI) {
       // we have a conditional branch. does it branch to me?
       // in other words, am i in that blocks successors?
+      unsigned int target =
+          proc.getBlockId(lastInst.operation.lvalues.front().getFullText());
       if (std::find(controlDepBlock.after.begin(), controlDepBlock.after.end(),
-                    lastInst.operation.lvalues.front().getFullText()) !=
-          controlDepBlock.after.end()) {
+                    target) != controlDepBlock.after.end()) {
         _instNecessary.insert(lastInst);
         if (_instVisited.find(lastInst) == _instVisited.end()) {
           _instWorklist.push_back(lastInst);
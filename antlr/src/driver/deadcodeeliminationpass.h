@@ -8,19 +8,20 @@
 class DeadCodeEliminationPass : public Pass {
 public:
   DeadCodeEliminationPass();
-  IlocProgram applyToProgram(IlocProgram prog);
+  void run(IlocProgram &prog);
 
 private:
   void eliminateDeadCode(IlocProcedure &proc);
   std::vector<Value> getRValuesFrom(const Instruction &inst);
   std::vector<Value> getRValuesFrom(const PhiNode &phi);
-  std::string getContainingBlockName(const Instruction &inst,
-                                     const IlocProcedure &proc);
-  std::string getContainingBlockName(const PhiNode &phi,
-                                     const IlocProcedure &proc);
+  unsigned int getContainingBlock(const Instruction &inst,
+                                  const IlocProcedure &proc);
+  unsigned int getContainingBlock(const PhiNode &phi,
+                                  const IlocProcedure &proc);
   void addDefinitionOfRValue(Value r, const IlocProcedure &proc);
   void addBranchesToBlock(const BasicBlock &block,
-                          const DominanceFrontiers &PDF);
+                          const DominanceFrontiers &PDF,
+                          const IlocProcedure &proc);
 
   DominatorTreePass PDTreePass;
   std::vector<Instruction> _instWorklist;
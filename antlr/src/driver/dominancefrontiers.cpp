@@ -1,57 +1,61 @@
+#include <iostream>
+
 #include "dominancefrontiers.h"
 
-DominanceFrontiers::DominanceFrontiers(DominatorTree tree,
+DominanceFrontiers::DominanceFrontiers(const IlocProcedure &proc,
+                                       const DominatorTree &tree,
                                        DominanceFrontiers::Mode mode)
-    : _root{tree}, _mode{mode} {
-  buildDominanceFrontiers(tree);
+    : _mode{mode} {
+  buildDominanceFrontiers(proc, tree);
 }
 
-std::set<BasicBlock>
-DominanceFrontiers::getDominanceFrontier(BasicBlock block) const {
-  return _frontiersMap.at(block);
+const std::vector<unsigned int> &
+DominanceFrontiers::getDominanceFrontier(unsigned int id) const {
+  return _frontiers[id];
 }
 
-void DominanceFrontiers::buildDominanceFrontiers(DominatorTree tree) {
-  for (auto node : tree.getChildren()) {
-    buildDominanceFrontiers(node);
-  }
-
-  // initialize
-  _frontiersMap.insert({tree.getBasicBlock(), {}});
-
-  for (auto child : tree.getChildren()) {
-    // propagate
-    for (auto block : _frontiersMap.at(child.getBasicBlock())) {
-      if (!tree.strictlyDominates(block)) {
-        _frontiersMap.at(tree.getBasicBlock()).insert(block);
+void DominanceFrontiers::buildDominanceFrontiers(const IlocProcedure &proc,
+                                                 const DominatorTree &tree) {
+  _frontiers.assign(proc.orderedBlocks().size(), {});
+
+  // a block is in the frontier of every node that dominates one of its
+  // predecessors without strictly dominating the block itself. those are the
+  // nodes on the tree path from the predecessor up to the block's immediate
+  // dominator. in postdominator mode, successors play the role of
+  // predecessors.
+  for (const auto &block : proc.orderedBlocks()) {
+    if (!tree.contains(block.id))
+      continue;
+
+    const std::vector<unsigned int> &preds =
+        _mode == Mode::dominator ? block.before : block.after;
+
+    for (auto pred : preds) {
+      if (!tree.contains(pred))
+        continue;
+
+      unsigned int runner = pred;
+      while (runner != DominatorTree::none &&
+             !tree.strictlyDominates(runner, block.id)) {
+        std::vector<unsigned int> &frontier = _frontiers[runner];
+        if (frontier.empty() || frontier.back() != block.id) {
+          frontier.push_back(block.id);
+        }
+        runner = tree.getParent(runner);
       }
     }
   }
-
-  // add new blocks
-  std::vector<std::string> blockList;
-  if (_mode == Mode::dominator)
-    blockList = tree.getBasicBlock().after;
-  else
-    blockList = tree.getBasicBlock().before;
-
-  for (auto blockName : blockList) {
-    if (!tree.hasBlockByName(blockName) ||
-        blockName == tree.getBasicBlock().debugName) {
-      BasicBlock block = _root.findNodeByBlockname(blockName).getBasicBlock();
-      _frontiersMap.at(tree.getBasicBlock()).insert(block);
-    }
-  }
 }
 
 DominanceFrontiers::Mode DominanceFrontiers::getMode() { return _mode; }
 
-void DominanceFrontiers::dump() const {
+void DominanceFrontiers::dump(const IlocProcedure &proc) const {
   // debug output
-  for (auto pair : _frontiersMap) {
-    std::cerr << "dominance frontier for " << pair.first.debugName << ":\n";
-    for (auto block : _frontiersMap.at(pair.first)) {
-      std::cerr << "   " << block.debugName << std::endl;
+  for (unsigned int id = 0; id < _frontiers.size(); id++) {
+    std::cerr << "dominance frontier for " << proc.getBlock(id).debugName
+              << ":\n";
+    for (auto frontierId : _frontiers[id]) {
+      std::cerr << "   " << proc.getBlock(frontierId).debugName << std::endl;
     }
   }
 }
@@ -1,20 +1,23 @@
 #pragma once
 
 #include "dominatortree.h"
+#include "ilocprocedure.h"
 
 class DominanceFrontiers {
 public:
   enum class Mode { dominator, postdominator };
-  DominanceFrontiers(DominatorTree tree, Mode mode = Mode::dominator);
-  std::set<BasicBlock> getDominanceFrontier(BasicBlock block) const;
+  DominanceFrontiers(const IlocProcedure &proc, const DominatorTree &tree,
+                     Mode mode = Mode::dominator);
+  const std::vector<unsigned int> &getDominanceFrontier(unsigned int id) const;
   Mode getMode();
 
-  void dump() const;
+  void dump(const IlocProcedure &proc) const;
 
 private:
-  void buildDominanceFrontiers(DominatorTree tree);
-  std::unordered_map<BasicBlock, std::set<BasicBlock>> _frontiersMap;
+  void buildDominanceFrontiers(const IlocProcedure &proc,
+                               const DominatorTree &tree);
+  // block id -> ids of the blocks in its frontier
+  std::vector<std::vector<unsigned int>> _frontiers;
 
-  DominatorTree _root;
   Mode _mode;
 };
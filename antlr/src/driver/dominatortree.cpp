@@ -1,112 +1,95 @@
-#include "dominatortree.h"
-
-DominatorTree::DominatorTree(BasicBlock block) : _block{block} {}
+#include <iostream>
 
-void DominatorTree::setBasicBlock(BasicBlock block) { _block = block; }
-
-BasicBlock DominatorTree::getBasicBlock() const { return _block; }
+#include "dominatortree.h"
 
-bool DominatorTree::hasBlockByName(std::string name) {
-  if (_block.debugName == name)
-    return true;
+const unsigned int DominatorTree::none;
 
-  for (auto node : _children) {
-    if (node.hasBlockByName(name)) {
-      return true;
+DominatorTree::DominatorTree(unsigned int root, std::vector<unsigned int> idoms)
+    : _root{root}, _idoms{idoms}, _children(idoms.size()),
+      _preorderNumbers(idoms.size(), none),
+      _postorderNumbers(idoms.size(), none) {
+  for (unsigned int id = 0; id < _idoms.size(); id++) {
+    if (_idoms[id] != none) {
+      _children[_idoms[id]].push_back(id);
     }
   }
 
-  return false;
-}
-
-DominatorTree DominatorTree::findNodeByBlockname(std::string name) {
-  if (_block.debugName == name)
-    return *this;
-
-  for (auto node : _children) {
-    try {
-      return node.findNodeByBlockname(name);
-    } catch (...) {
-      // couldn't find it in that child, try the next
+  // number the nodes with an iterative depth first walk
+  unsigned int nextPostorder = 0;
+  std::vector<std::pair<unsigned int, unsigned int>> stack = {{_root, 0}};
+  _preorderNumbers[_root] = _preorder.size();
+  _preorder.push_back(_root);
+
+  while (!stack.empty()) {
+    unsigned int id = stack.back().first;
+    unsigned int next = stack.back().second++;
+
+    if (next < _children[id].size()) {
+      unsigned int child = _children[id][next];
+      _preorderNumbers[child] = _preorder.size();
+      _preorder.push_back(child);
+      stack.push_back({child, 0});
+    } else {
+      _postorderNumbers[id] = nextPostorder++;
+      stack.pop_back();
     }
   }
-
-  throw "Couldn't find block by name " + name + " in tree.\n";
 }
 
-DominatorTree DominatorTree::findParentOf(std::string name) {
-  for (auto node : _children) {
-    if (node.getBasicBlock().debugName == name) {
-      return *this;
-    }
-  }
+unsigned int DominatorTree::getRoot() const { return _root; }
 
-  for (auto node : _children) {
-    try {
-      return node.findParentOf(name);
-    } catch (...) {
-      // couldn't find it in that child, try the next
-    }
-  }
+unsigned int DominatorTree::size() const { return _idoms.size(); }
 
-  throw "Couldn't find parent of block by name " + name + " in tree.\n";
+bool DominatorTree::contains(unsigned int id) const {
+  return id == _root || _idoms[id] != none;
 }
 
-void DominatorTree::addChild(DominatorTree node) { _children.push_back(node); }
-
-void DominatorTree::replaceChild(DominatorTree old, DominatorTree fresh) {
-  auto target = std::find(_children.begin(), _children.end(), old);
-
-  if (target == _children.end()) {
-    std::cerr << "Searched for child in replaceChild but found nothing.\n";
-    throw "Searched for child in replaceChild but found nothing.\n";
-  } else {
-    // found it
-    *target = fresh;
-  }
+unsigned int DominatorTree::getParent(unsigned int id) const {
+  return _idoms[id];
 }
 
-void DominatorTree::clearChildren() { _children.clear(); }
-
-std::vector<DominatorTree> DominatorTree::getChildren() const {
-  return _children;
+const std::vector<unsigned int> &
+DominatorTree::getChildren(unsigned int id) const {
+  return _children[id];
 }
 
-bool DominatorTree::dominates(BasicBlock block) const {
-  if (_block == block)
-    return true;
+bool DominatorTree::dominates(unsigned int a, unsigned int b) const {
+  if (!contains(a) || !contains(b))
+    return false;
 
-  for (auto node : _children) {
-    if (node.dominates(block)) {
-      return true;
-    }
-  }
+  return _preorderNumbers[a] <= _preorderNumbers[b] &&
+         _postorderNumbers[b] <= _postorderNumbers[a];
+}
 
-  return false;
+bool DominatorTree::strictlyDominates(unsigned int a, unsigned int b) const {
+  return a != b && dominates(a, b);
 }
 
-bool DominatorTree::strictlyDominates(BasicBlock block) const {
-  return (_block != block && dominates(block));
+unsigned int DominatorTree::getPreorderNumber(unsigned int id) const {
+  return _preorderNumbers[id];
 }
 
-std::vector<BasicBlock>
-DominatorTree::buildListPreorder(std::vector<BasicBlock> list) {
-  list.push_back(_block);
-  for (auto c : _children) {
-    list = c.buildListPreorder(list);
-  }
-  return list;
+unsigned int DominatorTree::getPostorderNumber(unsigned int id) const {
+  return _postorderNumbers[id];
 }
 
-void DominatorTree::printPreorder(unsigned int depth) {
-  std::cerr << std::string(depth * 2, '-') + " " << _block.debugName
-            << std::endl;
-  for (auto child : _children) {
-    child.printPreorder(depth + 1);
-  }
+const std::vector<unsigned int> &DominatorTree::getPreorder() const {
+  return _preorder;
 }
 
-bool operator==(const DominatorTree &a, const DominatorTree &b) {
-  return a.getBasicBlock() == b.getBasicBlock() &&
-         a.getChildren() == b.getChildren();
+void DominatorTree::printPreorder(const IlocProcedure &proc) const {
+  std::vector<std::pair<unsigned int, unsigned int>> stack = {{_root, 0}};
+
+  while (!stack.empty()) {
+    unsigned int id = stack.back().first;
+    unsigned int depth = stack.back().second;
+    stack.pop_back();
+
+    std::cerr << std::string(depth * 2, '-') + " "
+              << proc.getBlock(id).debugName << std::endl;
+
+    for (auto it = _children[id].rbegin(); it != _children[id].rend(); ++it) {
+      stack.push_back({*it, depth + 1});
+    }
+  }
 }
@@ -1,35 +1,44 @@
 #pragma once
 
+#include <limits>
 #include <vector>
 
-#include "basicblock.h"
+#include "ilocprocedure.h"
 
+// dominator (or postdominator) tree over the block ids of a procedure, stored
+// as an immediate dominator array. nodes are numbered in a depth first walk of
+// the tree, so a dominates b exactly when a's [preorder, postorder] interval
+// encloses b's.
 class DominatorTree {
 public:
+  // idom of the root and of blocks the tree doesn't reach
+  static const unsigned int none = std::numeric_limits<unsigned int>::max();
+
   DominatorTree() = default;
-  DominatorTree(BasicBlock block);
-  void setBasicBlock(BasicBlock block);
-  BasicBlock getBasicBlock() const;
+  DominatorTree(unsigned int root, std::vector<unsigned int> idoms);
 
-  bool hasBlockByName(std::string name);
-  DominatorTree findNodeByBlockname(std::string name);
-  DominatorTree findParentOf(std::string name);
+  unsigned int getRoot() const;
+  unsigned int size() const;
+  bool contains(unsigned int id) const;
+  unsigned int getParent(unsigned int id) const;
+  const std::vector<unsigned int> &getChildren(unsigned int id) const;
 
-  void addChild(DominatorTree node);
-  void replaceChild(DominatorTree old, DominatorTree fresh);
-  void clearChildren();
-  std::vector<DominatorTree> getChildren() const;
+  // constant time dominance queries
+  bool dominates(unsigned int a, unsigned int b) const;
+  bool strictlyDominates(unsigned int a, unsigned int b) const;
 
-  bool dominates(BasicBlock block) const;
-  bool strictlyDominates(BasicBlock block) const;
+  unsigned int getPreorderNumber(unsigned int id) const;
+  unsigned int getPostorderNumber(unsigned int id) const;
+  // ids of the nodes in the tree, in preorder
+  const std::vector<unsigned int> &getPreorder() const;
 
-  std::vector<BasicBlock>
-  buildListPreorder(std::vector<BasicBlock> list = std::vector<BasicBlock>());
-  void printPreorder(unsigned int depth = 0);
+  void printPreorder(const IlocProcedure &proc) const;
 
 private:
-  BasicBlock _block;
-  std::vector<DominatorTree> _children;
+  unsigned int _root;
+  std::vector<unsigned int> _idoms;
+  std::vector<std::vector<unsigned int>> _children;
+  std::vector<unsigned int> _preorderNumbers;
+  std::vector<unsigned int> _postorderNumbers;
+  std::vector<unsigned int> _preorder;
 };
-
-bool operator==(const DominatorTree &a, const DominatorTree &b);
@@ -11,17 +11,13 @@ class DominatorTreePass : public Pass {
 public:
   enum class Mode { dominator, postdominator };
   DominatorTreePass(Mode mode = Mode::dominator);
-  IlocProgram applyToProgram(IlocProgram prog);
-  DominatorTree getDominatorTree(IlocProcedure proc);
+  void run(IlocProgram &prog);
+  const DominatorTree &getDominatorTree(const IlocProcedure &proc);
 
 private:
-  std::unordered_map<BasicBlock, std::set<BasicBlock>>
-  getDominatorsMap(IlocProcedure proc);
-  DominatorTree buildTreeFromDominatorsMap(
-      std::unordered_map<BasicBlock, std::set<BasicBlock>> map,
-      const IlocProcedure &proc);
-  DominatorTree buildTreeFromProcedure(IlocProcedure proc);
-  std::unordered_map<IlocProcedure, DominatorTree> dominatorTreeMap;
+  DominatorTree buildTreeFromProcedure(const IlocProcedure &proc);
+  // procedure name -> tree
+  std::unordered_map<std::string, DominatorTree> dominatorTreeMap;
 
   const Mode _mode;
 };
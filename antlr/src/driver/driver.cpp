@@ -5,10 +5,14 @@
 #include "ilocLexer.h"
 #include "ilocParser.h"
 
+#include "callsummarypass.h"
+#include "chordalallocationpass.h"
 #include "codeemitter.h"
 #include "deadcodeeliminationpass.h"
 #include "ilocprogram.h"
 #include "ilocprogramvisitor.h"
+#include "instructionschedulingpass.h"
+#include "linearscanallocationpass.h"
 #include "lvnpass.h"
 #include "normalformpass.h"
 #include "optrenamepass.h"
@@ -16,11 +20,15 @@
 #include "registerbehaviorpass.h"
 #include "removedeletedpass.h"
 #include "ssapass.h"
+#include "targetmachine.h"
 
 int usage(int argc, const char *argv[]) {
   if (argc < 2) {
-    std::cerr << "Usage: ./driver <iloc_file> <passes: {l: lvn, s: "
-                 "ssa, d: dead code, r:reg alloc}>"
+    std::cerr << "Usage: ./driver <iloc_file> <passes: {m: call summaries, "
+                 "l: lvn, s: ssa, d: dead code, i: instruction scheduling, "
+                 "r:reg alloc, p: reg alloc with live range splitting, f: "
+                 "fast linear scan reg alloc, c: chordal ssa reg alloc, n: "
+                 "out of ssa}> <target: int=<registers>,float=<registers>>"
               << std::endl;
     return 1;
   }
@@ -42,6 +50,11 @@ int main(int argc, const char *argv[]) {
   else
     passes = argv[2];
 
+  // the machine registers are allocated for
+  TargetMachine target;
+  if (argc >= 4)
+    target = TargetMachine::parse(argv[3]);
+
   // open the file
   std::ifstream filestream;
   filestream.open(argv[1]);
@@ -66,26 +79,57 @@ int main(int argc, const char *argv[]) {
   LVNPass lvnpass;
   SSAPass ssapass;
   DeadCodeEliminationPass deadcodepass;
-  RegisterAllocationPass regallocpass;
+  RegisterAllocationPass regallocpass(target);
+  RegisterAllocationPass splitallocpass(
+      target, RegisterAllocationPass::SpillMode::split);
+  LinearScanAllocationPass linearscanpass(target);
+  ChordalAllocationPass chordalpass(target);
+  NormalFormPass normalformpass(target);
+  CallSummaryPass callsummarypass;
+  InstructionSchedulingPass schedulingpass(target);
 
-  program = regpass.applyToProgram(program);
+  regpass.run(program);
 
   for (auto chr : passes) {
     switch (chr) {
     case 'l':
-      program = lvnpass.applyToProgram(program);
+      lvnpass.run(program);
       break;
 
     case 's':
-      program = ssapass.applyToProgram(program);
+      ssapass.run(program);
       break;
 
     case 'd':
-      program = deadcodepass.applyToProgram(program);
+      deadcodepass.run(program);
       break;
 
     case 'r':
-      program = regallocpass.applyToProgram(program);
+      regallocpass.run(program);
+      break;
+
+    case 'p':
+      splitallocpass.run(program);
+      break;
+
+    case 'f':
+      linearscanpass.run(program);
+      break;
+
+    case 'c':
+      chordalpass.run(program);
+      break;
+
+    case 'n':
+      normalformpass.run(program);
+      break;
+
+    case 'm':
+      callsummarypass.run(program);
+      break;
+
+    case 'i':
+      schedulingpass.run(program);
       break;
 
     default:
@@ -0,0 +1,98 @@
+#include <algorithm>
+
+#include "edgecopies.h"
+
+#include "spillcode.h"
+
+static Value registerValue(const std::string &name) {
+  return Value(name, Value::Type::virtualReg, Value::Behavior::expression);
+}
+
+static Instruction createMove(const std::string &from, const std::string &to) {
+  Operation op(ilocParser::I2I);
+  op.arrow = "=>";
+  op.rvalues.push_back(registerValue(from));
+  op.lvalues.push_back(registerValue(to));
+  return Instruction(op);
+}
+
+unsigned int EdgeCopies::add(const IlocProcedure &proc, unsigned int from,
+                             unsigned int to, ParallelCopies pending,
+                             const TempFinder &findTemp,
+                             const SlotFinder &findSlot) {
+  if (pending.empty())
+    return 0;
+
+  std::vector<Instruction> copies;
+  unsigned int moves = 0;
+  // registers that get loaded back from the slot, once nothing reads their
+  // old value anymore
+  unsigned int slot = 0;
+  std::vector<std::string> reloads;
+  auto flushReloads = [&]() {
+    for (const auto &reg : reloads) {
+      createLoadAIInst(registerValue(reg), slot, copies, copies.end());
+    }
+    reloads.clear();
+  };
+
+  while (!pending.empty()) {
+    // a register no other copy reads from can be written
+    auto ready =
+        std::find_if(pending.begin(), pending.end(), [&](const auto &a) {
+          return std::none_of(
+              pending.begin(), pending.end(),
+              [&](const auto &b) { return b.second == a.first; });
+        });
+
+    if (ready != pending.end()) {
+      copies.push_back(createMove(ready->second, ready->first));
+      moves++;
+      pending.erase(ready);
+      continue;
+    }
+
+    // only cycles are left. move one of their registers out of the way. the
+    // slot is reused, so the reloads from the last cycle go first.
+    flushReloads();
+    std::string reg = pending.begin()->second;
+    std::string temp = findTemp(reg);
+    if (temp != "") {
+      copies.push_back(createMove(reg, temp));
+      moves++;
+      for (auto &pair : pending) {
+        if (pair.second == reg) {
+          pair.second = temp;
+        }
+      }
+      continue;
+    }
+
+    if (!findSlot) {
+      throw "no register to break a cycle of copies with!";
+    }
+    slot = findSlot();
+    createStoreAIInst(registerValue(reg), slot, copies, copies.end());
+    for (auto it = pending.begin(); it != pending.end();) {
+      if (it->second == reg) {
+        reloads.push_back(it->first);
+        it = pending.erase(it);
+      } else {
+        it++;
+      }
+    }
+  }
+  flushReloads();
+
+  _edges.push_back(
+      {proc.getBlock(from).debugName, proc.getBlock(to).debugName, copies});
+  return moves;
+}
+
+void EdgeCopies::insert(IlocProcedure &proc) {
+  for (auto &edge : _edges) {
+    proc.insertOnEdge(proc.getBlockId(edge.from), proc.getBlockId(edge.to),
+                      edge.copies);
+  }
+  _edges.clear();
+}
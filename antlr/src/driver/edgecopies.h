@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ilocprocedure.h"
+
+// the copies that take the place of phis when leaving ssa. the copies of an
+// edge happen in parallel, so they're ordered to read every register before
+// it is written. a cycle of them is broken by moving one of its registers out
+// of the way, to a spare register or to a stack slot. edges are kept by the
+// names of the blocks at their ends, since splitting edges renumbers blocks,
+// and all of them are inserted at once after the values have been renamed.
+class EdgeCopies {
+public:
+  // register -> register it's copied from
+  using ParallelCopies = std::map<std::string, std::string>;
+  // the register that can hold reg while a cycle is broken, empty if there
+  // is none
+  using TempFinder = std::function<std::string(const std::string &reg)>;
+  // the offset of a slot below %vr0 for when there's no spare register
+  using SlotFinder = std::function<unsigned int()>;
+
+  // orders the copies on the edge from one block to another, and returns the
+  // number of copies between registers that it took. findSlot is only called
+  // when findTemp comes back empty.
+  unsigned int add(const IlocProcedure &proc, unsigned int from,
+                   unsigned int to, ParallelCopies pending,
+                   const TempFinder &findTemp,
+                   const SlotFinder &findSlot = nullptr);
+  // puts every edge's copies on it
+  void insert(IlocProcedure &proc);
+
+private:
+  struct Edge {
+    std::string from;
+    std::string to;
+    std::vector<Instruction> copies;
+  };
+
+  std::vector<Edge> _edges;
+};
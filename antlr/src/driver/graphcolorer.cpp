@@ -0,0 +1,355 @@
+#include "graphcolorer.h"
+
+GraphColorer::GraphColorer(InterferenceGraph &igraph,
+                           const TargetMachine &target)
+    : _igraph(igraph), _target(target) {}
+
+unsigned int GraphColorer::getCoalescedMoves() const {
+  return _coalescedMoves;
+}
+
+void GraphColorer::color() {
+  buildWorklists();
+
+  while (!_simplifyWorklist.empty() || !_moveWorklist.empty() ||
+         !_freezeWorklist.empty() || _spillCount > 0) {
+    if (!_simplifyWorklist.empty()) {
+      simplify();
+    } else if (!_moveWorklist.empty()) {
+      coalesce();
+    } else if (!_freezeWorklist.empty()) {
+      freeze();
+    } else {
+      selectSpill();
+    }
+  }
+
+  assignColors();
+}
+
+void GraphColorer::buildWorklists() {
+  unsigned int size = _igraph.size();
+  const std::vector<InterferenceGraph::Move> &moves = _igraph.getMoves();
+
+  // the special registers' colors are never handed out to anything else, so
+  // they don't make their neighbors any harder to color. take them out of
+  // the graph until the end.
+  _nodeStates.assign(size, NodeState::stacked);
+  for (unsigned int node = 0; node < size; node++) {
+    if (_igraph.isPrecolored(node)) {
+      _nodeStates[node] = NodeState::precolored;
+      _igraph.removeNode(node);
+    }
+  }
+
+  _aliases.resize(size);
+  _nodeMoves.assign(size, {});
+  _marks.assign(size, 0);
+  for (unsigned int node = 0; node < size; node++) {
+    _aliases[node] = node;
+  }
+
+  _moveStates.assign(moves.size(), MoveState::worklist);
+  for (unsigned int move = 0; move < moves.size(); move++) {
+    _nodeMoves[moves[move].source].push_back(move);
+    _nodeMoves[moves[move].destination].push_back(move);
+    _moveWorklist.insert(move);
+  }
+
+  // setState needs a previous state to leave, everything else starts as
+  // stacked
+  for (unsigned int node = 0; node < size; node++) {
+    if (_nodeStates[node] == NodeState::precolored)
+      continue;
+
+    if (_igraph.getDegree(node) >= k(node)) {
+      setState(node, NodeState::spill);
+    } else if (isMoveRelated(node)) {
+      setState(node, NodeState::freeze);
+    } else {
+      setState(node, NodeState::simplify);
+    }
+  }
+}
+
+void GraphColorer::simplify() {
+  unsigned int node = *_simplifyWorklist.begin();
+  setState(node, NodeState::stacked);
+  _selectStack.push(node);
+
+  _igraph.removeNode(node);
+  for (auto neighbor : _igraph.getNeighbors(node)) {
+    if (!_igraph.isRemoved(neighbor)) {
+      lowerDegree(neighbor);
+    }
+  }
+}
+
+void GraphColorer::coalesce() {
+  unsigned int move = *_moveWorklist.begin();
+  _moveWorklist.erase(move);
+
+  unsigned int u = getAlias(_igraph.getMoves()[move].destination);
+  unsigned int v = getAlias(_igraph.getMoves()[move].source);
+
+  if (u == v) {
+    // already merged through other moves
+    _moveStates[move] = MoveState::coalesced;
+    _coalescedMoves++;
+    addWorklist(u);
+  } else if (!canCoalesce(u) || !canCoalesce(v) ||
+             _igraph.interferes(u, v) ||
+             _igraph.getNode(u).registerClass !=
+                 _igraph.getNode(v).registerClass) {
+    // can never be coalesced
+    _moveStates[move] = MoveState::constrained;
+    addWorklist(u);
+    addWorklist(v);
+  } else if (george(u, v) || briggs(u, v)) {
+    // the source's range merges into the destination's
+    _moveStates[move] = MoveState::coalesced;
+    _coalescedMoves++;
+    combine(u, v);
+    addWorklist(u);
+  } else {
+    // might become safe once neighbors are simplified
+    _moveStates[move] = MoveState::active;
+  }
+}
+
+void GraphColorer::freeze() {
+  unsigned int node = *_freezeWorklist.begin();
+  setState(node, NodeState::simplify);
+  freezeMoves(node);
+}
+
+void GraphColorer::selectSpill() {
+  while (!_spillWorklist.empty()) {
+    unsigned int node = _spillWorklist.top().second;
+    float cost = _spillWorklist.top().first;
+    _spillWorklist.pop();
+
+    if (_nodeStates[node] == NodeState::spill &&
+        cost == _igraph.getSpillCost(node)) {
+      // optimistically push it, it may still get a color
+      setState(node, NodeState::simplify);
+      freezeMoves(node);
+      return;
+    }
+  }
+
+  throw "spill worklist lost track of its nodes.";
+}
+
+void GraphColorer::assignColors() {
+  for (unsigned int node = 0; node < _igraph.size(); node++) {
+    if (_nodeStates[node] == NodeState::precolored) {
+      _igraph.restoreNode(node);
+      _igraph.colorNode(node, _target);
+    }
+  }
+
+  // nodes that were spill candidates only spill if they really end up
+  // without a color
+  while (!_selectStack.empty()) {
+    unsigned int node = _selectStack.top();
+    _selectStack.pop();
+    _igraph.restoreNode(node);
+    _igraph.colorNode(node, _target);
+  }
+
+  for (unsigned int node = 0; node < _igraph.size(); node++) {
+    if (_nodeStates[node] == NodeState::coalesced) {
+      _igraph.getNodeReference(node).color =
+          _igraph.getNode(getAlias(node)).color;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void GraphColorer::setState(unsigned int node, NodeState state) {
+  switch (_nodeStates[node]) {
+  case NodeState::simplify:
+    _simplifyWorklist.erase(node);
+    break;
+  case NodeState::freeze:
+    _freezeWorklist.erase(node);
+    break;
+  case NodeState::spill:
+    // its heap entries go stale
+    _spillCount--;
+    break;
+  default:
+    break;
+  }
+
+  _nodeStates[node] = state;
+
+  switch (state) {
+  case NodeState::simplify:
+    _simplifyWorklist.insert(node);
+    break;
+  case NodeState::freeze:
+    _freezeWorklist.insert(node);
+    break;
+  case NodeState::spill:
+    _spillWorklist.push({_igraph.getSpillCost(node), node});
+    _spillCount++;
+    break;
+  default:
+    break;
+  }
+}
+
+void GraphColorer::lowerDegree(unsigned int node) {
+  if (_nodeStates[node] != NodeState::spill)
+    return;
+
+  if (_igraph.getDegree(node) < k(node)) {
+    // became colorable. moves of it and its neighbors may now coalesce.
+    enableMoves(node);
+    for (auto neighbor : _igraph.getNeighbors(node)) {
+      if (!_igraph.isRemoved(neighbor)) {
+        enableMoves(neighbor);
+      }
+    }
+
+    setState(node,
+             isMoveRelated(node) ? NodeState::freeze : NodeState::simplify);
+  } else {
+    // cost went up
+    _spillWorklist.push({_igraph.getSpillCost(node), node});
+  }
+}
+
+void GraphColorer::enableMoves(unsigned int node) {
+  for (auto move : _nodeMoves[node]) {
+    if (_moveStates[move] == MoveState::active) {
+      _moveStates[move] = MoveState::worklist;
+      _moveWorklist.insert(move);
+    }
+  }
+}
+
+void GraphColorer::addWorklist(unsigned int node) {
+  if (_nodeStates[node] == NodeState::freeze && !isMoveRelated(node) &&
+      _igraph.getDegree(node) < k(node)) {
+    setState(node, NodeState::simplify);
+  }
+}
+
+void GraphColorer::freezeMoves(unsigned int node) {
+  for (auto move : _nodeMoves[node]) {
+    if (_moveStates[move] != MoveState::active &&
+        _moveStates[move] != MoveState::worklist)
+      continue;
+
+    unsigned int x = getAlias(_igraph.getMoves()[move].source);
+    unsigned int y = getAlias(_igraph.getMoves()[move].destination);
+    unsigned int other = y == getAlias(node) ? x : y;
+
+    _moveWorklist.erase(move);
+    _moveStates[move] = MoveState::frozen;
+
+    if (_nodeStates[other] == NodeState::freeze && !isMoveRelated(other) &&
+        _igraph.getDegree(other) < k(other)) {
+      setState(other, NodeState::simplify);
+    }
+  }
+}
+
+void GraphColorer::combine(unsigned int u, unsigned int v) {
+  setState(v, NodeState::coalesced);
+  _aliases[v] = u;
+  _nodeMoves[u].insert(_nodeMoves[u].end(), _nodeMoves[v].begin(),
+                       _nodeMoves[v].end());
+  enableMoves(v);
+
+  InterferenceGraphNode &uNode = _igraph.getNodeReference(u);
+  uNode.spillWeight += _igraph.getNode(v).spillWeight;
+
+  // u takes over every edge of v, including edges to nodes already on the
+  // stack, so they see u's color when they are colored
+  for (auto neighbor : _igraph.getNeighbors(v)) {
+    _igraph.connectNodes(neighbor, u);
+  }
+  _igraph.removeNode(v);
+  for (auto neighbor : _igraph.getNeighbors(v)) {
+    if (!_igraph.isRemoved(neighbor)) {
+      lowerDegree(neighbor);
+    }
+  }
+
+  if (_igraph.getDegree(u) >= k(u) && _nodeStates[u] == NodeState::freeze) {
+    setState(u, NodeState::spill);
+  } else if (_nodeStates[u] == NodeState::spill) {
+    // cost changed
+    _spillWorklist.push({_igraph.getSpillCost(u), u});
+  }
+}
+
+bool GraphColorer::briggs(unsigned int u, unsigned int v) {
+  // the merged node is colorable if it has fewer than k neighbors of
+  // significant degree
+  _mark++;
+  unsigned int significant = 0;
+  for (auto node : {u, v}) {
+    for (auto neighbor : _igraph.getNeighbors(node)) {
+      if (_igraph.isRemoved(neighbor) || _marks[neighbor] == _mark)
+        continue;
+
+      _marks[neighbor] = _mark;
+      if (_igraph.getDegree(neighbor) >= k(neighbor)) {
+        significant++;
+      }
+    }
+  }
+
+  return significant < k(u);
+}
+
+bool GraphColorer::george(unsigned int u, unsigned int v) const {
+  // v can merge into u if each of v's neighbors already interferes with u or
+  // is of insignificant degree
+  for (auto neighbor : _igraph.getNeighbors(v)) {
+    if (_igraph.isRemoved(neighbor))
+      continue;
+
+    if (_igraph.getDegree(neighbor) >= k(neighbor) &&
+        !_igraph.interferes(neighbor, u)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool GraphColorer::isMoveRelated(unsigned int node) const {
+  for (auto move : _nodeMoves[node]) {
+    if (_moveStates[move] == MoveState::active ||
+        _moveStates[move] == MoveState::worklist) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GraphColorer::canCoalesce(unsigned int node) const {
+  // special registers have fixed colors, and ranges that were already spilled
+  // have to stay as small as they are
+  return !_igraph.isPrecolored(node) && !_igraph.getNode(node).infiniteCost;
+}
+
+unsigned int GraphColorer::getAlias(unsigned int node) {
+  if (_nodeStates[node] != NodeState::coalesced) {
+    return node;
+  }
+
+  _aliases[node] = getAlias(_aliases[node]);
+  return _aliases[node];
+}
+
+unsigned int GraphColorer::k(unsigned int node) const {
+  return _target.getAllocatableRegisters(_igraph.getNode(node).registerClass);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <queue>
+#include <set>
+#include <stack>
+#include <vector>
+
+#include "interferencegraph.h"
+
+// colors an interference graph with iterated register coalescing (george and
+// appel). nodes are simplified, move related nodes are coalesced when the
+// briggs or george test says the merged node is no harder to color, and moves
+// that can't be coalesced are frozen. if none of that applies, the cheapest
+// node is picked as a spill candidate and optimistically simplified anyway.
+// nodes are then colored in the reverse order they were removed, and only the
+// ones left without a color are spilled. coalesced nodes take the color of the
+// node they were merged into.
+//
+// each register class is colored on its own. k is the number of registers a
+// node's class can hand out, and nodes of different classes never interfere
+// or get merged.
+class GraphColorer {
+public:
+  GraphColorer(InterferenceGraph &igraph, const TargetMachine &target);
+  void color();
+  // number of moves whose ends were merged
+  unsigned int getCoalescedMoves() const;
+
+private:
+  enum class NodeState {
+    simplify,
+    freeze,
+    spill,
+    stacked,
+    coalesced,
+    precolored
+  };
+  enum class MoveState { worklist, active, coalesced, constrained, frozen };
+
+  void buildWorklists();
+  void simplify();
+  void coalesce();
+  void freeze();
+  void selectSpill();
+  void assignColors();
+
+  void setState(unsigned int node, NodeState state);
+  void lowerDegree(unsigned int node);
+  void enableMoves(unsigned int node);
+  void addWorklist(unsigned int node);
+  void freezeMoves(unsigned int node);
+  void combine(unsigned int u, unsigned int v);
+  bool briggs(unsigned int u, unsigned int v);
+  bool george(unsigned int u, unsigned int v) const;
+  bool isMoveRelated(unsigned int node) const;
+  bool canCoalesce(unsigned int node) const;
+  unsigned int getAlias(unsigned int node);
+  // number of colors available to a node
+  unsigned int k(unsigned int node) const;
+
+  InterferenceGraph &_igraph;
+  const TargetMachine &_target;
+
+  std::vector<NodeState> _nodeStates;
+  std::vector<unsigned int> _aliases;
+  std::set<unsigned int> _simplifyWorklist;
+  std::set<unsigned int> _freezeWorklist;
+  // min-heap of (spill cost, node) for the nodes in the spill state, so its
+  // top is the cheapest entry. entries aren't removed when a node's cost goes
+  // up as its degree drops or when it leaves the spill state. lowerDegree
+  // pushes another entry with the new cost instead, and selectSpill pops and
+  // skips every entry whose node isn't a spill node anymore or whose cost no
+  // longer matches. _spillCount is the number of nodes in the spill state.
+  using SpillCandidate = std::pair<float, unsigned int>;
+  std::priority_queue<SpillCandidate, std::vector<SpillCandidate>,
+                      std::greater<SpillCandidate>>
+      _spillWorklist;
+  unsigned int _spillCount = 0;
+  std::stack<unsigned int> _selectStack;
+
+  std::vector<MoveState> _moveStates;
+  // node -> moves it is an end of
+  std::vector<std::vector<unsigned int>> _nodeMoves;
+  std::set<unsigned int> _moveWorklist;
+  unsigned int _coalescedMoves = 0;
+
+  // scratch marks for briggs, so the union of neighbors isn't counted twice
+  std::vector<unsigned int> _marks;
+  unsigned int _mark = 0;
+};
@@ -1,5 +1,23 @@
+#include <algorithm>
+
 #include "ilocprocedure.h"
 
+// the last instruction that runs in a block, the end if there is none
+template <typename Block> static auto lastInstruction(Block &block) {
+  auto it = std::find_if(
+      block.instructions.rbegin(), block.instructions.rend(),
+      [](const Instruction &inst) { return !inst.isDeleted(); });
+  return it == block.instructions.rend() ? block.instructions.end()
+                                         : --it.base();
+}
+
+// a branch that never falls through
+static bool isJump(const Operation &op) {
+  return op.opcode == ilocParser::JUMPI || op.opcode == ilocParser::JUMP ||
+         op.opcode == ilocParser::RET || op.opcode == ilocParser::IRET ||
+         op.opcode == ilocParser::FRET;
+}
+
 bool operator==(const IlocProcedure &a, const IlocProcedure &b) {
   return a.getFrame().name == b.getFrame().name;
 };
@@ -9,55 +27,186 @@ Frame &IlocProcedure::getFrameReference() { return frame; }
 
 void IlocProcedure::setFrame(Frame newFrame) { frame = newFrame; }
 
-void IlocProcedure::addBlock(std::string name, BasicBlock block) {
-  blocks.insert({name, block});
+unsigned int IlocProcedure::addBlock(BasicBlock block) {
+  block.id = blocks.size();
+  _blockIds[block.debugName] = block.id;
+  blocks.push_back(block);
+  return block.id;
 }
 
-void IlocProcedure::addBlocks(BlockStructure newBlocks) {
-  blocks.insert(newBlocks.begin(), newBlocks.end());
+unsigned int IlocProcedure::insertBlock(unsigned int position,
+                                       BasicBlock block) {
+  std::vector<unsigned int> newIds(blocks.size());
+  for (unsigned int id = 0; id < blocks.size(); id++) {
+    newIds[id] = id < position ? id : id + 1;
+  }
+
+  blocks.insert(blocks.begin() + position, block);
+  for (unsigned int id = 0; id < blocks.size(); id++) {
+    BasicBlock &b = blocks[id];
+    if (id != position) {
+      for (auto &pred : b.before) {
+        pred = newIds[pred];
+      }
+      for (auto &succ : b.after) {
+        succ = newIds[succ];
+      }
+      for (auto &phi : b.phinodes) {
+        phi.renumberPredecessors(newIds);
+      }
+    }
+
+    b.id = id;
+    for (auto &inst : b.instructions) {
+      inst.containingBlock = id;
+    }
+    _blockIds[b.debugName] = id;
+  }
+
+  _exitBlockId = newIds[_exitBlockId];
+  return position;
 }
 
-void IlocProcedure::addBlocks(std::vector<BasicBlock> newBlocks) {
-  for (auto block : newBlocks) {
-    blocks.insert({block.debugName, block});
+unsigned int IlocProcedure::splitEdge(unsigned int from, unsigned int to) {
+  std::string name = blocks[to].debugName + "_" + std::to_string(blocks.size());
+
+  // is the edge taken by a branch, or is it the fall through?
+  Instruction *branch = nullptr;
+  auto last = lastInstruction(blocks[from]);
+  if (last != blocks[from].instructions.end() &&
+      last->operation.category == Operation::Category::branch) {
+    branch = &*last;
+  }
+
+  bool taken = false;
+  if (branch != nullptr) {
+    for (auto &target : branch->operation.lvalues) {
+      if (target.getType() == Value::Type::label &&
+          target.getName() == blocks[to].debugName) {
+        target.setName(name);
+        taken = true;
+      }
+    }
+  }
+
+  BasicBlock block(name);
+  unsigned int id;
+  if (taken) {
+    Operation op(ilocParser::JUMPI);
+    op.arrow = "->";
+    op.lvalues.push_back(Value(blocks[to].debugName, Value::Type::label,
+                               Value::Behavior::unknown));
+    Instruction jump(op);
+    jump.label = name;
+    jump.containingBlock = blocks.size();
+    block.instructions.push_back(jump);
+    id = addBlock(block);
+  } else {
+    // the fall through has to stay right behind its source
+    id = insertBlock(from + 1, block);
+    if (to >= id) {
+      to++;
+    }
   }
+
+  BasicBlock &source = blocks[from];
+  BasicBlock &target = blocks[to];
+  std::replace(source.after.begin(), source.after.end(), to, id);
+  std::replace(target.before.begin(), target.before.end(), from, id);
+  blocks[id].before.push_back(from);
+  blocks[id].after.push_back(to);
+  for (auto &phi : target.phinodes) {
+    phi.replacePredecessor(from, id);
+  }
+
+  return id;
 }
 
-IlocProcedure::BlockStructure IlocProcedure::getBlocks() const {
-  return blocks;
+bool IlocProcedure::takesEdge(unsigned int from, unsigned int to) const {
+  // the last instruction that runs in the block decides
+  auto last = lastInstruction(blocks[from]);
+  if (last == blocks[from].instructions.end() ||
+      last->operation.category != Operation::Category::branch) {
+    return true;
+  }
+  for (const auto &target : last->operation.lvalues) {
+    if (target.getName() == blocks[to].debugName) {
+      return true;
+    }
+  }
+
+  // a conditional branch falls through when it isn't taken
+  return !isJump(last->operation) && to == from + 1;
 }
 
-BasicBlock IlocProcedure::getBlock(std::string name) const {
-  return blocks.at(name);
+unsigned int
+IlocProcedure::insertOnEdge(unsigned int from, unsigned int to,
+                            std::vector<Instruction> instructions) {
+  if (instructions.empty())
+    return from;
+
+  auto last = lastInstruction(blocks[from]);
+  unsigned int id = from;
+  if (last != blocks[from].instructions.end() &&
+      last->operation.category == Operation::Category::branch &&
+      !isJump(last->operation)) {
+    id = splitEdge(from, to);
+  }
+
+  BasicBlock &block = blocks[id];
+  auto pos = lastInstruction(block);
+  if (pos != block.instructions.end() &&
+      pos->operation.category != Operation::Category::branch) {
+    pos++;
+  }
+
+  // branches to a labeled instruction have to reach the new ones as well
+  if (pos != block.instructions.end() && pos->label != "") {
+    instructions.front().label = pos->label;
+    pos->label = "";
+  }
+  for (auto &inst : instructions) {
+    inst.containingBlock = id;
+  }
+  block.instructions.insert(pos, instructions.begin(), instructions.end());
+  return id;
 }
 
-BasicBlock &IlocProcedure::getBlockReference(std::string name) {
-  return blocks.at(name);
+const BasicBlock &IlocProcedure::getBlock(unsigned int id) const {
+  return blocks.at(id);
 }
 
-void IlocProcedure::clearBlocks() { blocks.clear(); }
+BasicBlock &IlocProcedure::getBlockReference(unsigned int id) {
+  return blocks.at(id);
+}
 
-std::vector<BasicBlock> IlocProcedure::orderedBlocks() const {
-  std::vector<BasicBlock> r;
+const BasicBlock &IlocProcedure::getBlock(std::string name) const {
+  return blocks.at(_blockIds.at(name));
+}
 
-  // extract to list and sort it by order number
-  for (auto pair : blocks) {
-    r.push_back(pair.second);
-  }
-  std::sort(r.begin(), r.end(), [](const BasicBlock &a, const BasicBlock &b) {
-    return a.order < b.order;
-  });
+BasicBlock &IlocProcedure::getBlockReference(std::string name) {
+  return blocks.at(_blockIds.at(name));
+}
+
+unsigned int IlocProcedure::getBlockId(std::string name) const {
+  return _blockIds.at(name);
+}
+
+const IlocProcedure::BlockList &IlocProcedure::orderedBlocks() const {
+  return blocks;
+}
 
-  return r;
+IlocProcedure::BlockList &IlocProcedure::orderedBlocksReference() {
+  return blocks;
 }
 
 std::unordered_set<Value, ValueNameHash, ValueNameEqual>
 IlocProcedure::getAllVariableNames() const {
   // compute fresh
   std::unordered_set<Value, ValueNameHash, ValueNameEqual> variables;
-  for (auto block : orderedBlocks()) {
-    for (auto inst : block.instructions) {
-      for (auto value : inst.operation.lvalues) {
+  for (const auto &block : blocks) {
+    for (const auto &inst : block.instructions) {
+      for (const auto &value : inst.operation.lvalues) {
         if (value.getType() == Value::Type::virtualReg) {
           variables.insert(value);
         }
@@ -83,11 +232,30 @@ IlocProcedure::getAllVariableNames() const {
   return variables;
 }
 
-SSAInfo IlocProcedure::getSSAInfo() const { return _ssainfo; }
+std::unordered_map<SymbolTable::Symbol, std::vector<unsigned int>>
+IlocProcedure::getDefinitionSites() const {
+  // variable name -> ids of the blocks that define it, in block order
+  std::unordered_map<SymbolTable::Symbol, std::vector<unsigned int>> sites;
+  for (const auto &block : blocks) {
+    for (const auto &inst : block.instructions) {
+      for (const auto &value : inst.operation.lvalues) {
+        if (value.getType() == Value::Type::virtualReg) {
+          auto &blockIds = sites[value.getNameSymbol()];
+          if (blockIds.empty() || blockIds.back() != block.id) {
+            blockIds.push_back(block.id);
+          }
+        }
+      }
+    }
+  }
+
+  return sites;
+}
+
+const SSAInfo &IlocProcedure::getSSAInfo() const { return _ssainfo; }
 
 SSAInfo &IlocProcedure::getSSAInfoReference() { return _ssainfo; }
 
-void IlocProcedure::setExitBlockName(std::string name) {
-  _exitBlockName = name;
-}
-std::string IlocProcedure::getExitBlockName() const { return _exitBlockName; }
+void IlocProcedure::setExitBlockId(unsigned int id) { _exitBlockId = id; }
+
+unsigned int IlocProcedure::getExitBlockId() const { return _exitBlockId; }
@@ -9,38 +9,59 @@
 
 class IlocProcedure {
 public:
-  using BlockStructure = std::unordered_map<std::string, BasicBlock>;
+  // blocks are stored in program order and identified by their index
+  using BlockList = std::vector<BasicBlock>;
+  IlocProcedure() = default;
+  // procedures are only ever moved, passes modify them in place
+  IlocProcedure(const IlocProcedure &) = delete;
+  IlocProcedure(IlocProcedure &&) = default;
+  IlocProcedure &operator=(const IlocProcedure &) = delete;
+  IlocProcedure &operator=(IlocProcedure &&) = default;
   Frame getFrame() const;
   Frame &getFrameReference();
   void setFrame(Frame frame);
-  void addBlock(std::string name, BasicBlock block);
-  void addBlocks(BlockStructure newBlocks);
-  void addBlocks(std::vector<BasicBlock> newBlocks);
-  BasicBlock getBlock(std::string name) const;
+  unsigned int addBlock(BasicBlock block);
+  // inserts a block in front of the one at position. the blocks after it
+  // move up by one and everything that refers to them is renumbered, except
+  // for the ssa info.
+  unsigned int insertBlock(unsigned int position, BasicBlock block);
+  // puts a new block on the edge between two blocks and returns its id. a
+  // fall through gets an empty block in between. a branch is redirected to a
+  // labeled block at the end of the procedure holding a jump to the target,
+  // so code for the edge goes in front of that jump.
+  unsigned int splitEdge(unsigned int from, unsigned int to);
+  // whether control can actually go along an edge of the cfg. dead code
+  // elimination turns branches into jumps without updating the cfg, so some
+  // edges are never taken.
+  bool takesEdge(unsigned int from, unsigned int to) const;
+  // puts instructions on the edge between two blocks and returns the id of
+  // the block they went into. they go at the end of from, in front of its
+  // jump, unless from ends in a conditional branch, which has another way out,
+  // so the edge is split to hold them.
+  unsigned int insertOnEdge(unsigned int from, unsigned int to,
+                            std::vector<Instruction> instructions);
+  const BasicBlock &getBlock(unsigned int id) const;
+  BasicBlock &getBlockReference(unsigned int id);
+  const BasicBlock &getBlock(std::string name) const;
   BasicBlock &getBlockReference(std::string name);
-  BlockStructure getBlocks() const;
-  void clearBlocks();
-  std::vector<BasicBlock> orderedBlocks() const;
+  unsigned int getBlockId(std::string name) const;
+  const BlockList &orderedBlocks() const;
+  BlockList &orderedBlocksReference();
   std::unordered_set<Value, ValueNameHash, ValueNameEqual>
   getAllVariableNames() const;
-  SSAInfo getSSAInfo() const;
+  std::unordered_map<SymbolTable::Symbol, std::vector<unsigned int>>
+  getDefinitionSites() const;
+  const SSAInfo &getSSAInfo() const;
   SSAInfo &getSSAInfoReference();
-  void setExitBlockName(std::string name);
-  std::string getExitBlockName() const;
+  void setExitBlockId(unsigned int id);
+  unsigned int getExitBlockId() const;
 
 private:
   Frame frame;
-  BlockStructure blocks;
-  std::string _exitBlockName;
+  BlockList blocks;
+  std::unordered_map<std::string, unsigned int> _blockIds;
+  unsigned int _exitBlockId;
   SSAInfo _ssainfo;
 };
 
-namespace std {
-template <> struct hash<IlocProcedure> {
-  std::size_t operator()(const IlocProcedure &p) const noexcept {
-    return std::hash<std::string>{}(p.getFrame().name);
-  }
-};
-} // namespace std
-
 bool operator==(const IlocProcedure &a, const IlocProcedure &b);
@@ -13,15 +13,16 @@ void IlocProgram::addPseudoOps(std::vector<std::string> newPseudoOps) {
 std::vector<std::string> IlocProgram::getPseudoOps() const { return pseudoOps; }
 
 void IlocProgram::addProcedure(IlocProcedure proc) {
-  procedures.push_back(proc);
+  procedures.push_back(std::move(proc));
 }
 
 void IlocProgram::addProcedures(std::vector<IlocProcedure> newProcedures) {
-  procedures.insert(procedures.end(), newProcedures.begin(),
-                    newProcedures.end());
+  for (auto &proc : newProcedures) {
+    procedures.push_back(std::move(proc));
+  }
 }
 
-std::vector<IlocProcedure> IlocProgram::getProcedures() const {
+const std::vector<IlocProcedure> &IlocProgram::getProcedures() const {
   return procedures;
 }
 
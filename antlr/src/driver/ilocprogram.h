@@ -8,12 +8,17 @@
 class IlocProgram {
 public:
   IlocProgram();
+  // programs are only ever moved, passes modify them in place
+  IlocProgram(const IlocProgram &) = delete;
+  IlocProgram(IlocProgram &&) = default;
+  IlocProgram &operator=(const IlocProgram &) = delete;
+  IlocProgram &operator=(IlocProgram &&) = default;
   void addPseudoOp(std::string pseudoOp);
   void addPseudoOps(std::vector<std::string> PseudoOps);
   std::vector<std::string> getPseudoOps() const;
   void addProcedure(IlocProcedure proc);
   void addProcedures(std::vector<IlocProcedure> procedures);
-  std::vector<IlocProcedure> getProcedures() const;
+  const std::vector<IlocProcedure> &getProcedures() const;
   std::vector<IlocProcedure> &getProceduresReference();
   void clearProcedures();
   bool isSSA();
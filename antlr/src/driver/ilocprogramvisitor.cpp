@@ -13,7 +13,7 @@
 
 IlocProgram
 IlocProgramVisitor::extractProgram(ilocParser::ProgramContext *ctx) {
-  return visitProgram(ctx).as<IlocProgram>();
+  return std::move(visitProgram(ctx).as<IlocProgram>());
 }
 
 antlrcpp::Any
@@ -30,9 +30,9 @@ IlocProgramVisitor::visitProgram(ilocParser::ProgramContext *ctx) {
 
   auto procedures = visitProcedures(ctx->procedures());
 
-  me.addProcedures(procedures.as<std::vector<IlocProcedure>>());
+  me.addProcedures(std::move(procedures.as<std::vector<IlocProcedure>>()));
 
-  return me;
+  return std::move(me);
 }
 
 antlrcpp::Any IlocProgramVisitor::visitData(ilocParser::DataContext *ctx) {
@@ -63,11 +63,11 @@ IlocProgramVisitor::visitProcedures(ilocParser::ProceduresContext *ctx) {
 
   for (auto proc : ctx->procedure()) {
     // get procedure
-    auto me = visitProcedure(proc).as<IlocProcedure>();
-    us.push_back(me);
+    auto me = visitProcedure(proc);
+    us.push_back(std::move(me.as<IlocProcedure>()));
   }
 
-  return us;
+  return std::move(us);
 }
 
 antlrcpp::Any
@@ -85,11 +85,21 @@ IlocProgramVisitor::visitProcedure(ilocParser::ProcedureContext *ctx) {
     instructions.push_back(inst);
   }
 
-  // turn instructions into basic blocks
-  std::unordered_map<std::string, BasicBlock> blocks;
+  // turn instructions into basic blocks. blocks are numbered in the order they
+  // are created, and names are only used to resolve branch targets.
+  std::vector<BasicBlock> blocks;
+  std::unordered_map<std::string, unsigned int> blockIds;
   std::vector<std::pair<std::string, std::string>> toLink;
+  auto createBlock = [&](std::string name) {
+    if (blockIds.find(name) == blockIds.end()) {
+      blockIds.insert({name, blocks.size()});
+      blocks.emplace_back(name);
+    }
+    return blockIds.at(name);
+  };
+
   std::string currentBlockName = "entry";
-  blocks.emplace(currentBlockName, BasicBlock(currentBlockName));
+  unsigned int currentBlock = createBlock(currentBlockName);
   uint nextKey = 0;
   std::pair<std::string, std::string> pendingLink = {"", ""};
 
@@ -101,7 +111,7 @@ IlocProgramVisitor::visitProcedure(ilocParser::ProcedureContext *ctx) {
 
       // create block
       currentBlockName = inst.label;
-      blocks.emplace(currentBlockName, BasicBlock(currentBlockName));
+      currentBlock = createBlock(currentBlockName);
     }
 
     // connect anything pending
@@ -111,8 +121,7 @@ IlocProgramVisitor::visitProcedure(ilocParser::ProcedureContext *ctx) {
     }
 
     // record instruction
-    inst.containingBlockName = currentBlockName;
-    blocks.at(currentBlockName).instructions.push_back(inst);
+    blocks[currentBlock].instructions.push_back(inst);
 
     // make new block after branches
     if (inst.operation.category == Operation::Category::branch) {
@@ -126,102 +135,118 @@ IlocProgramVisitor::visitProcedure(ilocParser::ProcedureContext *ctx) {
 
       // create block
       currentBlockName = "unamed" + std::to_string(nextKey++);
-      blocks.emplace(currentBlockName, BasicBlock(currentBlockName));
+      currentBlock = createBlock(currentBlockName);
     }
   }
 
   // remove any blocks of zero length. these get created either when the last
   // instruction is a branch (including a return) or a block is created after
   // a branch, but the branch is immediately followed by a labeled instruction
-  std::vector<std::string> toErase;
-  for (auto pair : blocks) {
-    if (pair.second.instructions.size() == 0) {
-      toErase.push_back(pair.first);
+  std::vector<bool> removed(blocks.size(), false);
+  for (unsigned int id = 0; id < blocks.size(); id++) {
+    if (blocks[id].instructions.size() == 0) {
+      removed[id] = true;
     }
   }
-  for (auto blk : toErase) {
-    blocks.erase(blk);
-  }
 
   // std::cerr << "Created " << blocks.size() << " basic blocks." << std::endl;
 
   // link up basic blocks by looking at our saved list
   for (auto pair : toLink) {
     // it's possible that some of the blocks saved in link pairs got deleted
-    if (blocks.find(pair.first) != blocks.end() and
-        blocks.find(pair.second) != blocks.end()) {
-      blocks.at(pair.first).after.push_back(pair.second);
-      blocks.at(pair.second).before.push_back(pair.first);
+    if (blockIds.find(pair.first) != blockIds.end() and
+        blockIds.find(pair.second) != blockIds.end()) {
+      unsigned int from = blockIds.at(pair.first);
+      unsigned int to = blockIds.at(pair.second);
+      if (!removed[from] and !removed[to]) {
+        blocks[from].after.push_back(to);
+        blocks[to].before.push_back(from);
+      }
     }
   }
 
   // create exit block
-  BasicBlock exit("exit");
+  unsigned int exit = blocks.size();
+  blocks.emplace_back("exit");
+  removed.push_back(false);
 
   // find the exit points
-  for (auto &pair : blocks) {
-    auto &block = pair.second;
+  for (unsigned int id = 0; id < exit; id++) {
+    auto &block = blocks[id];
+    if (removed[id]) {
+      continue;
+    }
+
     if (block.instructions.back().operation.opcode == ilocParser::RET ||
         block.instructions.back().operation.opcode == ilocParser::IRET ||
         block.instructions.back().operation.opcode == ilocParser::FRET) {
 
-      for (auto afterName : block.after) {
-        BasicBlock &afterBlock = blocks.at(afterName);
-        afterBlock.before.erase(std::find(afterBlock.before.begin(),
-                                          afterBlock.before.end(),
-                                          block.debugName));
+      for (auto afterId : block.after) {
+        auto &afterBefore = blocks[afterId].before;
+        afterBefore.erase(
+            std::find(afterBefore.begin(), afterBefore.end(), id));
       }
 
       block.after.clear();
-      block.after.push_back("exit");
-      exit.before.push_back(block.debugName);
+      block.after.push_back(exit);
+      blocks[exit].before.push_back(id);
     }
   }
 
-  // set exit block
-  me.setExitBlockName(exit.debugName);
-  blocks.insert({"exit", exit});
-
-  // remove unreachable blocks'
+  // remove unreachable blocks
   bool dirty = true;
   while (dirty == true) {
     dirty = false;
 
-    for (auto &pair : blocks) {
-      BasicBlock &block = pair.second;
+    for (unsigned int id = 1; id < blocks.size(); id++) {
+      BasicBlock &block = blocks[id];
 
-      if (block.debugName != "entry" and block.before.size() == 0) {
+      if (!removed[id] and block.before.size() == 0) {
         // no predecessors, unreachable.
-        for (auto afterName : block.after) {
-          BasicBlock &afterBlock = blocks.at(afterName);
-          afterBlock.before.erase(std::find(afterBlock.before.begin(),
-                                            afterBlock.before.end(),
-                                            block.debugName));
+        for (auto afterId : block.after) {
+          auto &afterBefore = blocks[afterId].before;
+          afterBefore.erase(
+              std::find(afterBefore.begin(), afterBefore.end(), id));
         }
-        blocks.erase(block.debugName);
+        block.after.clear();
+        removed[id] = true;
         dirty = true;
       }
     }
   }
 
-  // debug print
-  // for (auto pair : blocks) {
-  //     std::cerr << pair.second.toString();
-  //     std::cerr << "before:";
-  //     for (auto name : pair.second.before) {
-  //         std::cerr << " " << name;
-  //     }
-  //     std::cerr << std::endl;
-
-  //     std::cerr << "after:";
-  //     for (auto name : pair.second.after) {
-  //         std::cerr << " " << name;
-  //     }
-  //     std::cerr << std::endl << std::endl;
-  // }
-
-  me.addBlocks(blocks);
-  return me;
+  // renumber the surviving blocks densely, keeping their order
+  std::vector<unsigned int> newIds(blocks.size(), 0);
+  unsigned int nextId = 0;
+  for (unsigned int id = 0; id < blocks.size(); id++) {
+    if (!removed[id]) {
+      newIds[id] = nextId++;
+    }
+  }
+
+  for (unsigned int id = 0; id < blocks.size(); id++) {
+    if (removed[id]) {
+      continue;
+    }
+
+    BasicBlock &block = blocks[id];
+    for (auto &pred : block.before) {
+      pred = newIds[pred];
+    }
+    for (auto &succ : block.after) {
+      succ = newIds[succ];
+    }
+    for (auto &inst : block.instructions) {
+      inst.containingBlock = newIds[id];
+    }
+
+    me.addBlock(block);
+  }
+
+  // set exit block
+  me.setExitBlockId(newIds[exit]);
+
+  return std::move(me);
 }
 
 antlrcpp::Any IlocProgramVisitor::visitFrameInstruction(
@@ -128,7 +128,33 @@ void Operation::fixValues() {
   }
 }
 
-Instruction::Instruction(Operation o) : operation(o), deleted(false) {}
+std::vector<std::pair<unsigned int, unsigned int>>
+Operation::getWrittenArguments() const {
+  std::vector<std::pair<unsigned int, unsigned int>> pairs;
+  if (opcode != ilocParser::CALL && opcode != ilocParser::ICALL &&
+      opcode != ilocParser::FCALL) {
+    return pairs;
+  }
+
+  // functions with return values have one extra lvalue. an argument keeps
+  // its register's name through every renaming, only its subscript changes.
+  std::vector<bool> paired(rvalues.size(), false);
+  unsigned int lValueIndex = opcode == ilocParser::CALL ? 0 : 1;
+  for (; lValueIndex < lvalues.size(); lValueIndex++) {
+    for (unsigned int i = 0; i < rvalues.size(); i++) {
+      if (!paired[i] && rvalues[i].getType() == Value::Type::virtualReg &&
+          rvalues[i].getName() == lvalues[lValueIndex].getName()) {
+        pairs.push_back({i, lValueIndex});
+        paired[i] = true;
+        break;
+      }
+    }
+  }
+  return pairs;
+}
+
+Instruction::Instruction(Operation o)
+    : containingBlock(0), operation(o), deleted(false) {}
 
 std::unordered_map<Operation::Category, std::string> catMap = {
     {Operation::Category::nop, "NOP"},
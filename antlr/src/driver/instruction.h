@@ -14,6 +14,11 @@ public:
   void recategorize();
   Value::Behavior generateBehavior();
   void fixValues();
+  // pairs the lvalues of a call with the arguments they write back into, as
+  // (rvalue index, lvalue index). an argument the callee never writes has no
+  // lvalue, so the two don't line up by position.
+  std::vector<std::pair<unsigned int, unsigned int>>
+  getWrittenArguments() const;
 
   enum class Category {
     unknown,
@@ -39,7 +44,7 @@ class Instruction {
 public:
   Instruction(Operation o);
   std::string label;
-  std::string containingBlockName;
+  unsigned int containingBlock;
   Operation operation;
 
   bool isDeleted() const;
@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "instructionschedulingpass.h"
+
+static bool isLoad(const Operation &op) {
+  switch (op.opcode) {
+  case ilocParser::LOAD:
+  case ilocParser::LOADAI:
+  case ilocParser::LOADAO:
+  case ilocParser::FLOAD:
+  case ilocParser::FLOADAI:
+  case ilocParser::FLOADAO:
+  case ilocParser::SWRITE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool isCall(const Operation &op) {
+  return op.opcode == ilocParser::CALL || op.opcode == ilocParser::ICALL ||
+         op.opcode == ilocParser::FCALL;
+}
+
+// calls can do anything to memory
+static bool isStore(const Operation &op) {
+  switch (op.opcode) {
+  case ilocParser::STORE:
+  case ilocParser::STOREAI:
+  case ilocParser::STOREAO:
+  case ilocParser::FSTORE:
+  case ilocParser::FSTOREAI:
+  case ilocParser::FSTOREAO:
+  case ilocParser::IREAD:
+  case ilocParser::FREAD:
+    return true;
+  default:
+    return isCall(op);
+  }
+}
+
+InstructionSchedulingPass::InstructionSchedulingPass(
+    const TargetMachine &target)
+    : _target(target) {}
+
+void InstructionSchedulingPass::run(IlocProgram &prog) {
+  std::cerr << "scheduling instructions\n";
+
+  _reordered = 0;
+  _lowered = 0;
+  _lvapass.run(prog);
+
+  for (auto &proc : prog.getProceduresReference()) {
+    _classes = _target.classifyValues(proc);
+    for (auto &block : proc.orderedBlocksReference()) {
+      ValueSet live;
+      for (const auto &value : _lvapass.getBlockSets(proc, block).out) {
+        if (isRegister(value)) {
+          live.insert(value);
+        }
+      }
+
+      // phi operands are used on the way out of the block
+      for (auto succId : block.after) {
+        for (const auto &phi : proc.getBlock(succId).phinodes) {
+          if (phi.isDeleted())
+            continue;
+
+          auto it = phi.getRValueMap().find(block.id);
+          if (it != phi.getRValueMap().end() && isRegister(it->second)) {
+            live.insert(it->second);
+          }
+        }
+      }
+
+      scheduleBlock(block, live);
+    }
+  }
+
+  std::cerr << _reordered << " blocks reordered, needing " << _lowered
+            << " fewer registers.\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void InstructionSchedulingPass::scheduleBlock(BasicBlock &block,
+                                              ValueSet live) {
+  // the block in pieces, each a barrier or the region between two of them
+  std::vector<std::vector<Instruction>> pieces(1);
+  for (const auto &inst : block.instructions) {
+    if (inst.isDeleted())
+      continue;
+
+    if (isBarrier(inst)) {
+      pieces.push_back({inst});
+      pieces.push_back({});
+    } else {
+      pieces.back().push_back(inst);
+    }
+  }
+
+  // from the bottom up, so live holds what's live after each piece
+  bool reordered = false;
+  for (auto it = pieces.rbegin(); it != pieces.rend(); it++) {
+    // a barrier is a piece of its own
+    if (it->size() > 1) {
+      reordered |= scheduleRegion(*it, live);
+    }
+
+    for (auto inst = it->rbegin(); inst != it->rend(); inst++) {
+      for (const auto &lval : inst->operation.lvalues) {
+        live.erase(lval);
+      }
+      for (const auto &rval : inst->operation.rvalues) {
+        if (isRegister(rval)) {
+          live.insert(rval);
+        }
+      }
+    }
+  }
+
+  if (!reordered)
+    return;
+
+  _reordered++;
+  block.instructions.clear();
+  for (const auto &piece : pieces) {
+    block.instructions.insert(block.instructions.end(), piece.begin(),
+                              piece.end());
+  }
+}
+
+bool InstructionSchedulingPass::scheduleRegion(std::vector<Instruction> &region,
+                                               const ValueSet &liveOut) {
+  std::vector<Node> graph = buildGraph(region);
+
+  // the registers each instruction reads and writes, once each
+  std::vector<ValueSet> reads(region.size());
+  std::vector<ValueSet> writes(region.size());
+  for (unsigned int i = 0; i < region.size(); i++) {
+    for (const auto &rval : region[i].operation.rvalues) {
+      if (isRegister(rval)) {
+        reads[i].insert(rval);
+      }
+    }
+    for (const auto &lval : region[i].operation.lvalues) {
+      if (isRegister(lval)) {
+        writes[i].insert(lval);
+      }
+    }
+  }
+
+  // scheduling goes from the bottom up, so live holds what's live below the
+  // instructions placed so far. an instruction ends the values it defines and
+  // starts the ones it reads.
+  ValueSet live = liveOut;
+  // how many more registers are live above an instruction than below it.
+  // a definition nothing reads takes a register at the instruction all the
+  // same, as getPressure counts it.
+  auto getDelta = [&](unsigned int i) {
+    int delta = 0;
+    int dead = 0;
+    for (const auto &lval : writes[i]) {
+      if (live.find(lval) != live.end()) {
+        delta--;
+      } else {
+        dead++;
+      }
+    }
+    for (const auto &rval : reads[i]) {
+      if (writes[i].find(rval) != writes[i].end() ||
+          live.find(rval) == live.end()) {
+        delta++;
+      }
+    }
+    return std::max(delta, dead);
+  };
+
+  // fewest new live values, then the shortest path to the end of the
+  // region, so long ones start early, then program order
+  auto isBetter = [&](unsigned int a, unsigned int b) {
+    int deltaA = getDelta(a);
+    int deltaB = getDelta(b);
+    if (deltaA != deltaB)
+      return deltaA < deltaB;
+
+    if (graph[a].height != graph[b].height)
+      return graph[a].height < graph[b].height;
+    return a > b;
+  };
+
+  // instructions whose successors have all been placed
+  std::vector<unsigned int> waiting(region.size());
+  std::vector<unsigned int> ready;
+  for (unsigned int i = 0; i < region.size(); i++) {
+    waiting[i] = graph[i].successors.size();
+    if (waiting[i] == 0) {
+      ready.push_back(i);
+    }
+  }
+
+  std::vector<Instruction> scheduled;
+  while (!ready.empty()) {
+    auto best = ready.begin();
+    for (auto it = ready.begin() + 1; it != ready.end(); it++) {
+      if (isBetter(*it, *best)) {
+        best = it;
+      }
+    }
+
+    unsigned int i = *best;
+    ready.erase(best);
+    scheduled.push_back(region[i]);
+
+    for (const auto &lval : writes[i]) {
+      live.erase(lval);
+    }
+    live.insert(reads[i].begin(), reads[i].end());
+
+    for (auto pred : graph[i].predecessors) {
+      if (--waiting[pred] == 0) {
+        ready.push_back(pred);
+      }
+    }
+  }
+  std::reverse(scheduled.begin(), scheduled.end());
+
+  // fewer registers at the peak don't help if the values live longer, and
+  // one class can't pay for another
+  ClassPressure before = getPressure(region, liveOut);
+  ClassPressure after = getPressure(scheduled, liveOut);
+  unsigned int lowered = 0;
+  for (auto cls : TargetMachine::classes) {
+    if (after[cls].most > before[cls].most ||
+        after[cls].total > before[cls].total)
+      return false;
+
+    lowered += before[cls].most - after[cls].most;
+  }
+  if (lowered == 0)
+    return false;
+
+  _lowered += lowered;
+  region = scheduled;
+  return true;
+}
+
+std::vector<InstructionSchedulingPass::Node>
+InstructionSchedulingPass::buildGraph(const std::vector<Instruction> &region) {
+  std::vector<Node> graph(region.size());
+  auto addEdge = [&](unsigned int from, unsigned int to) {
+    auto &successors = graph[from].successors;
+    if (from != to &&
+        std::find(successors.begin(), successors.end(), to) ==
+            successors.end()) {
+      successors.push_back(to);
+      graph[to].predecessors.push_back(from);
+    }
+  };
+
+  // register -> its last definition, and the reads of it since then
+  std::unordered_map<Value, unsigned int> definitions;
+  std::unordered_map<Value, std::vector<unsigned int>> reads;
+  // memory: the last write and the reads since then
+  int lastStore = -1;
+  std::vector<unsigned int> loads;
+  int lastIO = -1;
+
+  for (unsigned int i = 0; i < region.size(); i++) {
+    const Operation &op = region[i].operation;
+
+    for (const auto &rval : op.rvalues) {
+      if (rval.getType() != Value::Type::virtualReg)
+        continue;
+
+      auto def = definitions.find(rval);
+      if (def != definitions.end()) {
+        addEdge(def->second, i);
+      }
+      reads[rval].push_back(i);
+    }
+
+    for (const auto &lval : op.lvalues) {
+      if (lval.getType() != Value::Type::virtualReg)
+        continue;
+
+      auto def = definitions.find(lval);
+      if (def != definitions.end()) {
+        addEdge(def->second, i);
+      }
+      for (auto read : reads[lval]) {
+        addEdge(read, i);
+      }
+      definitions[lval] = i;
+      reads[lval].clear();
+    }
+
+    bool store = isStore(op);
+    if ((store || isLoad(op)) && lastStore != -1) {
+      addEdge(lastStore, i);
+    }
+    if (store) {
+      for (auto load : loads) {
+        addEdge(load, i);
+      }
+      loads.clear();
+      lastStore = i;
+    } else if (isLoad(op)) {
+      loads.push_back(i);
+    }
+
+    if (op.category == Operation::Category::io || isCall(op)) {
+      if (lastIO != -1) {
+        addEdge(lastIO, i);
+      }
+      lastIO = i;
+    }
+  }
+
+  // edges only go forward
+  for (auto i = region.size(); i-- > 0;) {
+    unsigned int longest = 0;
+    for (auto succ : graph[i].successors) {
+      longest = std::max(longest, graph[succ].height);
+    }
+    graph[i].height = _target.getLatency(region[i].operation.opcode) + longest;
+  }
+
+  return graph;
+}
+
+InstructionSchedulingPass::ClassPressure
+InstructionSchedulingPass::getPressure(
+    const std::vector<Instruction> &instructions,
+    const ValueSet &liveOut) const {
+  // registers live of each class
+  ValueSet live;
+  std::map<TargetMachine::RegisterClass, unsigned int> counts;
+  auto insert = [&](const Value &value) {
+    if (live.insert(value).second) {
+      counts[getClass(value)]++;
+    }
+  };
+  auto erase = [&](const Value &value) {
+    if (live.erase(value) > 0) {
+      counts[getClass(value)]--;
+    }
+  };
+
+  for (const auto &value : liveOut) {
+    insert(value);
+  }
+  ClassPressure pressure;
+  for (auto cls : TargetMachine::classes) {
+    pressure[cls] = {counts[cls], 0};
+  }
+
+  for (auto it = instructions.rbegin(); it != instructions.rend(); it++) {
+    // a definition takes a register even if nothing reads it
+    auto defined = counts;
+    for (const auto &lval : it->operation.lvalues) {
+      if (isRegister(lval) && live.find(lval) == live.end()) {
+        defined[getClass(lval)]++;
+      }
+    }
+
+    for (const auto &lval : it->operation.lvalues) {
+      erase(lval);
+    }
+    for (const auto &rval : it->operation.rvalues) {
+      if (isRegister(rval)) {
+        insert(rval);
+      }
+    }
+
+    for (auto cls : TargetMachine::classes) {
+      pressure[cls].most =
+          std::max({pressure[cls].most, defined[cls], counts[cls]});
+      pressure[cls].total += counts[cls];
+    }
+  }
+
+  return pressure;
+}
+
+bool InstructionSchedulingPass::isBarrier(const Instruction &inst) const {
+  return inst.label != "" ||
+         inst.operation.category == Operation::Category::branch;
+}
+
+bool InstructionSchedulingPass::isRegister(const Value &value) const {
+  if (value.getType() != Value::Type::virtualReg)
+    return false;
+
+  // the special registers have registers of their own
+  unsigned int reserved =
+      _target.getReservedRegisters(TargetMachine::RegisterClass::integer);
+  for (unsigned int reg = 0; reg < reserved; reg++) {
+    if (value.getName() == "%vr" + std::to_string(reg)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TargetMachine::RegisterClass
+InstructionSchedulingPass::getClass(const Value &value) const {
+  auto it = _classes.find(value);
+  return it == _classes.end() ? TargetMachine::RegisterClass::integer
+                              : it->second;
+}
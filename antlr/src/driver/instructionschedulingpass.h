@@ -0,0 +1,70 @@
+#pragma once
+
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "livevariableanalysispass.h"
+#include "pass.h"
+#include "targetmachine.h"
+
+// reorders the instructions of each block before register allocation, to
+// lower the most registers that are live at once. instructions depend on the
+// ones before them that define or use the same registers, and memory
+// operations, i/o and calls keep their order relative to each other, except
+// that loads can pass loads. a labeled instruction stays first and a branch
+// stays last.
+//
+// instructions are placed from the bottom of the block up, so a value is
+// computed once everything that reads it has been placed and its live range
+// ends there. of the instructions that can go next, the one that leaves the
+// fewest values live above it goes first, which finishes one expression
+// before starting the next like sethi-ullman numbering would. ties go to the
+// shortest path of latencies to the end of the block, so long ones start
+// early. a block keeps its order unless the new one needs fewer registers at
+// its peak in some register class, and no class needs more registers at its
+// peak or keeps its values live any longer overall.
+class InstructionSchedulingPass : public Pass {
+public:
+  InstructionSchedulingPass(const TargetMachine &target);
+  void run(IlocProgram &prog);
+
+private:
+  using ValueSet = std::unordered_set<Value>;
+
+  struct Node {
+    std::vector<unsigned int> predecessors;
+    std::vector<unsigned int> successors;
+    // cycles from the start of the instruction to the end of the region
+    unsigned int height = 0;
+  };
+
+  struct Pressure {
+    unsigned int most;
+    unsigned int total;
+  };
+  using ClassPressure = std::map<TargetMachine::RegisterClass, Pressure>;
+
+  void scheduleBlock(BasicBlock &block, ValueSet live);
+  // reorders instructions with no barrier between them if that lowers the
+  // pressure, returns whether it did
+  bool scheduleRegion(std::vector<Instruction> &region,
+                      const ValueSet &liveOut);
+  std::vector<Node> buildGraph(const std::vector<Instruction> &region);
+  // registers of each class live in instructions followed by liveOut: the
+  // most at once, and the sum over every instruction
+  ClassPressure getPressure(const std::vector<Instruction> &instructions,
+                            const ValueSet &liveOut) const;
+  bool isBarrier(const Instruction &inst) const;
+  bool isRegister(const Value &value) const;
+  // the class whose registers a value is kept in
+  TargetMachine::RegisterClass getClass(const Value &value) const;
+
+  const TargetMachine &_target;
+  LiveVariableAnalysisPass<HardValueSet> _lvapass;
+  // allocation class of each register of the procedure being scheduled
+  std::unordered_map<Value, TargetMachine::RegisterClass> _classes;
+  unsigned int _reordered;
+  unsigned int _lowered;
+};
@@ -1,287 +1,292 @@
+#include <algorithm>
+
 #include "interferencegraph.h"
 
-bool operator==(const InterferenceGraphNode &a,
-                const InterferenceGraphNode &b) {
-  return a.name == b.name;
+InterferenceGraphNode::InterferenceGraphNode()
+    : registerClass(TargetMachine::RegisterClass::integer), color(uncolored),
+      precolor(uncolored), spillWeight{0}, infiniteCost{false} {}
+
+InterferenceGraphNode::InterferenceGraphNode(std::string _name)
+    : registerClass(TargetMachine::RegisterClass::integer), color(uncolored),
+      precolor(uncolored), spillWeight{0}, infiniteCost{false}, name{_name} {}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void InterferenceGraph::reset(unsigned int size) {
+  _nodes.assign(size, InterferenceGraphNode());
+  _matrix = BitVector(size * (size - 1) / 2 + 1);
+  _neighbors.assign(size, {});
+  _moves.clear();
+  _degrees.assign(size, 0);
+  _removed.assign(size, false);
+  _remaining = size;
 }
 
-bool operator<(const InterferenceGraphNode &a, const InterferenceGraphNode &b) {
-  return a.name < b.name;
+unsigned int InterferenceGraph::size() const { return _nodes.size(); }
+
+const InterferenceGraphNode &InterferenceGraph::getNode(unsigned int id) const {
+  return _nodes.at(id);
 }
 
-InterferenceGraphNode::InterferenceGraphNode()
-    : color(InterferenceGraphColor::uncolored), uses{0}, infiniteCost{false} {}
+InterferenceGraphNode &InterferenceGraph::getNodeReference(unsigned int id) {
+  return _nodes.at(id);
+}
 
-InterferenceGraphNode::InterferenceGraphNode(std::string _name)
-    : color(InterferenceGraphColor::uncolored), uses{0},
-      infiniteCost{false}, name{_name} {}
+bool InterferenceGraph::isPrecolored(unsigned int id) const {
+  return _nodes.at(id).precolor != InterferenceGraphNode::uncolored;
+}
 
-int InterferenceGraphNode::getDegree() { return edges.size(); }
+unsigned int InterferenceGraph::bitIndex(unsigned int a,
+                                         unsigned int b) const {
+  // lower triangle, without the diagonal
+  if (a < b)
+    std::swap(a, b);
+  return a * (a - 1) / 2 + b;
+}
 
-float InterferenceGraphNode::getSpillCost() {
-  if (getDegree() > 0 and infiniteCost == false) {
-    return static_cast<float>(uses) / static_cast<float>(getDegree());
-  } else {
-    return 1000000.0;
-  }
+void InterferenceGraph::connectNodes(unsigned int a, unsigned int b) {
+  if (a == b || interferes(a, b) ||
+      _nodes[a].registerClass != _nodes[b].registerClass)
+    return;
+
+  _matrix.set(bitIndex(a, b));
+  _neighbors[a].push_back(b);
+  _neighbors[b].push_back(a);
+
+  if (!_removed[a])
+    _degrees[b]++;
+  if (!_removed[b])
+    _degrees[a]++;
 }
 
-////////////////////////////////////////////////////////////////////////////////
+void InterferenceGraph::disconnectNode(unsigned int id) {
+  for (auto neighbor : _neighbors[id]) {
+    _matrix.reset(bitIndex(id, neighbor));
+
+    auto &list = _neighbors[neighbor];
+    list.erase(std::find(list.begin(), list.end(), id));
 
-void InterferenceGraph::addNode(InterferenceGraphNode node) {
-  if (_graphMap.find(node.name) != _graphMap.end()) {
-    throw "tried to add a node that was already in the graph.\n";
+    if (!_removed[id])
+      _degrees[neighbor]--;
+    if (!_removed[neighbor])
+      _degrees[id]--;
   }
+  _neighbors[id].clear();
+}
 
-  auto savedEdges = node.edges;
-  node.edges.clear();
+bool InterferenceGraph::interferes(unsigned int a, unsigned int b) const {
+  return a != b && _matrix.test(bitIndex(a, b));
+}
 
-  _graphMap.insert({node.name, node});
+const std::vector<unsigned int> &
+InterferenceGraph::getNeighbors(unsigned int id) const {
+  return _neighbors.at(id);
+}
 
-  // connect any saved edges
-  for (auto edge : savedEdges) {
-    if (_graphMap.find(edge.name) != _graphMap.end()) {
-      connectNodes(node, edge);
-    }
+void InterferenceGraph::addMove(unsigned int source,
+                                unsigned int destination) {
+  if (source != destination) {
+    _moves.push_back({source, destination});
   }
 }
 
-InterferenceGraphNode InterferenceGraph::getNode(std::string name) {
-  return _graphMap.at(name);
+const std::vector<InterferenceGraph::Move> &
+InterferenceGraph::getMoves() const {
+  return _moves;
 }
 
-void InterferenceGraph::removeNode(InterferenceGraphNode node) {
-  // disconnect any edges
-  for (auto edge : _graphMap.at(node.name).edges) {
-    _graphMap.at(edge.name).edges.erase(node);
-  }
+void InterferenceGraph::weighRanges(const LiveRanges &ranges,
+                                    const IlocProcedure &proc,
+                                    const std::vector<unsigned int> &loopDepths,
+                                    const std::set<LiveRange> &infinites,
+                                    const std::vector<bool> &dirty) {
+  // weigh every definition and use for spill costs. a reference in a loop is
+  // assumed to run ten times as often as one outside of it.
+  auto definitionWeight = [&](const Value &lval, float weight) {
+    return ranges.getRangeWithValue(lval).remat ? 0.0f : weight;
+  };
+
+  for (const auto &block : proc.orderedBlocks()) {
+    float weight = std::pow(10.0f, static_cast<float>(loopDepths[block.id]));
+
+    for (const auto &inst : block.instructions) {
+      if (inst.isDeleted())
+        continue;
 
-  // remove any edges that now point to nothing
-  for (auto edge : node.edges) {
-    disconnectNodes(node, edge);
+      for (const auto &rval : inst.operation.rvalues) {
+        if (rval.getType() == Value::Type::virtualReg) {
+          unsigned int id = ranges.getRangeWithValue(rval).id;
+          if (dirty[id])
+            _nodes[id].spillWeight += weight;
+        }
+      }
+      for (const auto &lval : inst.operation.lvalues) {
+        if (lval.getType() == Value::Type::virtualReg) {
+          unsigned int id = ranges.getRangeWithValue(lval).id;
+          if (dirty[id])
+            _nodes[id].spillWeight += definitionWeight(lval, weight);
+        }
+      }
+    }
   }
 
-  _graphMap.erase(node.name);
+  // set infinites
+  for (const auto &lr : ranges.getRanges()) {
+    _nodes[lr.id].infiniteCost = infinites.find(lr) != infinites.end();
+  }
 }
 
-void InterferenceGraph::connectNodes(InterferenceGraphNode a,
-                                     InterferenceGraphNode b) {
-  if (a.name == b.name)
-    return;
+void InterferenceGraph::removeNode(unsigned int id) {
+  if (_removed[id]) {
+    throw "tried to remove a node that was already removed.";
+  }
 
-  _graphMap.at(a.name).edges.insert(b);
-  _graphMap.at(b.name).edges.insert(a);
+  _removed[id] = true;
+  _remaining--;
+  for (auto neighbor : _neighbors[id]) {
+    _degrees[neighbor]--;
+  }
 }
 
-void InterferenceGraph::disconnectNodes(InterferenceGraphNode a,
-                                        InterferenceGraphNode b) {
-  if (a.name == b.name)
-    return;
+void InterferenceGraph::restoreNode(unsigned int id) {
+  if (!_removed[id]) {
+    throw "tried to restore a node that was already in the graph.";
+  }
 
-  _graphMap.at(a.name).edges.erase(b);
-  _graphMap.at(b.name).edges.erase(a);
+  _removed[id] = false;
+  _remaining++;
+  for (auto neighbor : _neighbors[id]) {
+    _degrees[neighbor]++;
+  }
 }
 
-bool InterferenceGraph::empty() { return _graphMap.empty(); }
+bool InterferenceGraph::isRemoved(unsigned int id) const {
+  return _removed.at(id);
+}
 
-bool InterferenceGraph::colorNode(InterferenceGraphNode nodeCopy,
-                                  unsigned int max) {
-  std::set<InterferenceGraphColor> notAvailable{
-      InterferenceGraphColor::uncolored, InterferenceGraphColor::vr0,
-      InterferenceGraphColor::vr1,       InterferenceGraphColor::vr2,
-      InterferenceGraphColor::vr3,
-  };
+bool InterferenceGraph::empty() const { return _remaining == 0; }
 
-  InterferenceGraphNode &node = _graphMap.at(nodeCopy.name);
+unsigned int InterferenceGraph::getDegree(unsigned int id) const {
+  return _degrees.at(id);
+}
 
-  // handle special nodes
-  if (node.name == "%vr0_0") {
-    node.color = InterferenceGraphColor::vr0;
-    return true;
-  } else if (node.name == "%vr1_0") {
-    node.color = InterferenceGraphColor::vr1;
-    return true;
-  } else if (node.name == "%vr2_0") {
-    node.color = InterferenceGraphColor::vr2;
-    return true;
-  } else if (node.name == "%vr3_0") {
-    node.color = InterferenceGraphColor::vr3;
-    return true;
+float InterferenceGraph::getSpillCost(unsigned int id) const {
+  const InterferenceGraphNode &node = _nodes.at(id);
+  if (getDegree(id) > 0 and node.infiniteCost == false) {
+    return node.spillWeight / static_cast<float>(getDegree(id));
+  } else {
+    return 1000000.0;
   }
+}
+
+bool InterferenceGraph::colorNode(unsigned int id,
+                                  const TargetMachine &target) {
+  InterferenceGraphNode &node = _nodes.at(id);
 
-  // eliminate available colors
-  for (auto edge : node.edges) {
-    notAvailable.insert(_graphMap.at(edge.name).color);
+  // the special registers keep their own
+  if (isPrecolored(id)) {
+    node.color = node.precolor;
+    return true;
   }
 
-  // find lowest available color
-  // start at 4 because colors 0-3 correspond to special registers and are never
-  // available
-  for (unsigned int i = 4; i < max; i++) {
-    InterferenceGraphColor color = static_cast<InterferenceGraphColor>(i);
+  // eliminate colors taken by neighbors still in the graph
+  std::vector<bool> notAvailable(target.getTotalRegisters(), false);
+  for (auto neighbor : _neighbors[id]) {
+    int color = _nodes[neighbor].color;
+    if (!_removed[neighbor] && color != InterferenceGraphNode::uncolored) {
+      notAvailable[color] = true;
+    }
+  }
 
-    if (notAvailable.find(color) == notAvailable.end()) {
+  // find the lowest available color. the reserved registers of the class are
+  // never available.
+  for (unsigned int i = target.getFirstAllocatable(node.registerClass);
+       i < target.getEndRegister(node.registerClass); i++) {
+    if (notAvailable[i] == false) {
       // found an available color
-      node.color = color;
+      node.color = i;
       return true;
     }
   }
 
   // couldn't find a color
-  node.color = InterferenceGraphColor::uncolored;
+  node.color = InterferenceGraphNode::uncolored;
   return false;
 }
 
 void InterferenceGraph::test() {
   std::cerr << "InterferenceGraph::test()\n";
 
-  // create 4 nodes
-  addNode(InterferenceGraphNode("a"));
-  addNode(InterferenceGraphNode("b"));
-  addNode(InterferenceGraphNode("c"));
-  addNode(InterferenceGraphNode("d"));
-
-  try {
-    addNode(InterferenceGraphNode("d"));
-    std::cerr << "uh oh, no error was thrown upon inserting duplicate node.\n";
-  } catch (...) {
-    std::cerr << "an error occured upon insterting a duplicate node, as it "
-                 "should have.\n";
-  }
+  // create 4 nodes: a, b, c, d
+  reset(4);
 
   // connect a to b
-  connectNodes(InterferenceGraphNode("a"), InterferenceGraphNode("b"));
+  connectNodes(0, 1);
 
   // connect c to d
-  connectNodes(InterferenceGraphNode("c"), InterferenceGraphNode("d"));
-
-  // connect d to b
-  connectNodes(InterferenceGraphNode("d"), InterferenceGraphNode("b"));
-
-  // get a
-  std::cerr << "node a has " << getNode("a").edges.size()
-            << " edges. (should be 1)\n";
-  // get b
-  std::cerr << "node b has " << getNode("b").edges.size()
-            << " edges. (should be 2)\n";
-  // get c
-  std::cerr << "node c has " << getNode("c").edges.size()
-            << " edges. (should be 1)\n";
-  // get d
-  std::cerr << "node d has " << getNode("d").edges.size()
-            << " edges. (should be 2)\n";
-
-  // remove b
-  removeNode(InterferenceGraphNode("b"));
-
-  // get a again
-  std::cerr << "node a has " << getNode("a").edges.size()
-            << " edges. (should be 0)\n";
-  // get d again
-  std::cerr << "node d has " << getNode("d").edges.size()
-            << " edges. (should be 1)\n";
-
-  // disconnect c from d
-  disconnectNodes(InterferenceGraphNode("c"), InterferenceGraphNode("d"));
+  connectNodes(2, 3);
 
-  // get c again
-  std::cerr << "node c has " << getNode("c").edges.size()
-            << " edges. (should be 0)\n";
-  // get d
-  std::cerr << "node d has " << getNode("d").edges.size()
-            << " edges. (should be 0)\n";
+  // connect d to b, twice
+  connectNodes(3, 1);
+  connectNodes(1, 3);
 
-  _graphMap.clear();
+  std::cerr << "node a has " << getDegree(0) << " edges. (should be 1)\n";
+  std::cerr << "node b has " << getDegree(1) << " edges. (should be 2)\n";
+  std::cerr << "node c has " << getDegree(2) << " edges. (should be 1)\n";
+  std::cerr << "node d has " << getDegree(3) << " edges. (should be 2)\n";
+  std::cerr << "b and d interfere: " << interferes(1, 3)
+            << " (should be 1)\n";
+  std::cerr << "a and c interfere: " << interferes(0, 2)
+            << " (should be 0)\n";
 
-  // test removing nodes with edges and re-adding them
-  std::string a = "a";
-  std::string b = "b";
-  std::string c = "c";
-
-  addNode(a);
-  addNode(b);
-  addNode(c);
-
-  connectNodes(a, b);
-  connectNodes(b, c);
-
-  std::cerr << "node b has " << getNode("b").edges.size()
-            << " edges. (should be 2)\n";
-
-  InterferenceGraphNode bNode = getNode("b");
-  removeNode(b);
+  // remove b
+  removeNode(1);
 
-  std::cerr << "node a has " << getNode("a").edges.size()
-            << " edges. (should be 0)\n";
+  std::cerr << "node a has " << getDegree(0) << " edges. (should be 0)\n";
+  std::cerr << "node d has " << getDegree(3) << " edges. (should be 1)\n";
 
-  std::cerr << "node c has " << getNode("c").edges.size()
-            << " edges. (should be 0)\n";
+  try {
+    removeNode(1);
+    std::cerr << "uh oh, no error was thrown upon removing a node twice.\n";
+  } catch (...) {
+    std::cerr << "an error occured upon removing a node twice, as it "
+                 "should have.\n";
+  }
 
-  addNode(bNode);
-  std::cerr << "node a has " << getNode("a").edges.size()
-            << " edges. (should be 1)\n";
+  // put b back
+  restoreNode(1);
 
-  std::cerr << "node b has " << getNode("b").edges.size()
-            << " edges. (should be 2)\n";
+  std::cerr << "node a has " << getDegree(0) << " edges. (should be 1)\n";
+  std::cerr << "node b has " << getDegree(1) << " edges. (should be 2)\n";
+  std::cerr << "node d has " << getDegree(3) << " edges. (should be 2)\n";
 
-  std::cerr << "node c has " << getNode("c").edges.size()
-            << " edges. (should be 1)\n";
+  reset(0);
 }
 
-void InterferenceGraph::dump() {
-  for (auto pair : _graphMap) {
-    std::cerr << pair.first << " (" << pair.second.getSpillCost()
-              << ") (color: " << pair.second.color << "): " << std::endl;
-    for (auto edge : pair.second.edges) {
-      std::cerr << "   " << edge.name << std::endl;
+void InterferenceGraph::dump() const {
+  for (unsigned int id = 0; id < _nodes.size(); id++) {
+    std::cerr << _nodes[id].name << " (" << getSpillCost(id)
+              << ") (color: " << _nodes[id].color << "): " << std::endl;
+    for (auto neighbor : _neighbors[id]) {
+      std::cerr << "   " << _nodes[neighbor].name << std::endl;
     }
   }
 }
 
-unsigned int InterferenceGraph::minDegree() {
+unsigned int InterferenceGraph::minDegree() const {
   unsigned int min = UINT32_MAX;
-  for (auto pair : _graphMap) {
-    min = pair.second.getDegree() < min ? pair.second.getDegree() : min;
+  for (unsigned int id = 0; id < _nodes.size(); id++) {
+    if (!_removed[id])
+      min = _degrees[id] < min ? _degrees[id] : min;
   }
   return min;
 }
 
-unsigned int InterferenceGraph::maxDegree() {
+unsigned int InterferenceGraph::maxDegree() const {
   unsigned int max = 0;
-  for (auto pair : _graphMap) {
-    max = pair.second.getDegree() > max ? pair.second.getDegree() : max;
+  for (unsigned int id = 0; id < _nodes.size(); id++) {
+    if (!_removed[id])
+      max = _degrees[id] > max ? _degrees[id] : max;
   }
   return max;
 }
-
-InterferenceGraphNode
-InterferenceGraph::getAnyNodeWithDegree(unsigned int degree) {
-  for (auto pair : _graphMap) {
-    if (pair.second.getDegree() == degree) {
-      return pair.second;
-    }
-  }
-
-  throw "couldn't find a node with that degree.";
-}
-
-InterferenceGraphNode InterferenceGraph::getLowestSpillcostNode() {
-  InterferenceGraphNode cheap;
-  float cheapestCost;
-  bool first = true;
-
-  for (auto pair : _graphMap) {
-    if (first == true) {
-      cheapestCost = pair.second.getSpillCost();
-      cheap = pair.second;
-      first = false;
-    } else {
-      if (pair.second.getSpillCost() < cheapestCost) {
-        cheapestCost = pair.second.getSpillCost();
-        cheap = pair.second;
-      }
-    }
-  }
-
-  return cheap;
-}
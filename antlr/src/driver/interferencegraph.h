@@ -1,95 +1,188 @@
 #pragma once
 
-#include <map>
+#include <cmath>
 #include <set>
 #include <string>
+#include <vector>
 
+#include "bitvector.h"
 #include "liverangespass.h"
 #include "livevariableanalysispass.h"
-
-enum InterferenceGraphColor {
-  uncolored = -1,
-  vr0,
-  vr1,
-  vr2,
-  vr3,
-  red,
-  red_orange,
-  orange,
-  orange_yellow,
-  yellow,
-  yellow_green,
-  green,
-  green_blue,
-  blue,
-  indigo,
-  violet,
-  white,
-  black
-};
+#include "targetmachine.h"
 
 struct InterferenceGraphNode {
   InterferenceGraphNode();
   InterferenceGraphNode(std::string name);
-  int getDegree();
-  float getSpillCost();
+
+  static const int uncolored = -1;
 
   std::string name;
-  unsigned int uses;
-  std::set<InterferenceGraphNode> edges;
-  InterferenceGraphColor color;
+  // registers of other classes are never shared, so nodes only interfere
+  // with nodes of their own class
+  TargetMachine::RegisterClass registerClass;
+  // what spilling the range would add to the code: its uses and definitions,
+  // each weighted by 10^(loop depth). a rematerializable range's definitions
+  // are deleted rather than followed by a store, so only its uses count.
+  float spillWeight;
+  // register the range is given, or uncolored
+  int color;
+  // special register the range is and always keeps, or uncolored
+  int precolor;
   bool infiniteCost;
 };
 
-bool operator==(const InterferenceGraphNode &a, const InterferenceGraphNode &b);
-bool operator<(const InterferenceGraphNode &a, const InterferenceGraphNode &b);
-
 ////////////////////////////////////////////////////////////////////////////////
 
+// interference graph over the live ranges of a procedure, with nodes indexed
+// by live range id. edges are kept twice: in a triangular bit matrix for
+// constant time interference tests, and in adjacency vectors for walking a
+// node's neighbors.
+//
+// simplification removes nodes without touching the edges. a removed node
+// no longer counts towards its neighbors' degrees until it is restored.
 class InterferenceGraph {
 public:
+  // a register to register copy between two live ranges
+  struct Move {
+    unsigned int source;
+    unsigned int destination;
+  };
+
   template <typename SetType>
-  void createFromLiveRanges(LiveRangesPass lrpass, IlocProcedure proc,
-                            LiveVariableAnalysisPass<SetType> lvapass,
-                            std::set<LiveRange> infinites);
-
-  void addNode(InterferenceGraphNode node);
-  InterferenceGraphNode getNode(std::string name);
-  void removeNode(InterferenceGraphNode node);
-  void connectNodes(InterferenceGraphNode a, InterferenceGraphNode b);
-  void disconnectNodes(InterferenceGraphNode a, InterferenceGraphNode b);
-  bool empty();
-  unsigned int minDegree();
-  unsigned int maxDegree();
-  InterferenceGraphNode getAnyNodeWithDegree(unsigned int degree);
-  InterferenceGraphNode getLowestSpillcostNode();
-  bool colorNode(InterferenceGraphNode node, unsigned int max);
+  void createFromLiveRanges(LiveRangesPass &lrpass,
+                            const IlocProcedure &proc,
+                            LiveVariableAnalysisPass<SetType> &lvapass,
+                            const std::vector<unsigned int> &loopDepths,
+                            const std::set<LiveRange> &infinites,
+                            const TargetMachine &target);
+  // rebuilds the edges and spill weights of some nodes only, after spill code
+  // for them was added without renaming anything. nodes keep their ids and
+  // classes, and the moves stay as they were.
+  template <typename SetType>
+  void updateNodes(const std::vector<unsigned int> &ids,
+                   LiveRangesPass &lrpass, const IlocProcedure &proc,
+                   LiveVariableAnalysisPass<SetType> &lvapass,
+                   const std::vector<unsigned int> &loopDepths,
+                   const std::set<LiveRange> &infinites);
+
+  void reset(unsigned int size);
+  unsigned int size() const;
+  const InterferenceGraphNode &getNode(unsigned int id) const;
+  InterferenceGraphNode &getNodeReference(unsigned int id);
+  // nodes for the special registers, which always get their own color
+  bool isPrecolored(unsigned int id) const;
+
+  void connectNodes(unsigned int a, unsigned int b);
+  bool interferes(unsigned int a, unsigned int b) const;
+  const std::vector<unsigned int> &getNeighbors(unsigned int id) const;
+
+  void addMove(unsigned int source, unsigned int destination);
+  const std::vector<Move> &getMoves() const;
+
+  void removeNode(unsigned int id);
+  void restoreNode(unsigned int id);
+  bool isRemoved(unsigned int id) const;
+  bool empty() const;
+  // degree among the nodes that haven't been removed
+  unsigned int getDegree(unsigned int id) const;
+  float getSpillCost(unsigned int id) const;
+
+  unsigned int minDegree() const;
+  unsigned int maxDegree() const;
+  // gives the node the lowest register of its class that no neighbor still
+  // in the graph has
+  bool colorNode(unsigned int id, const TargetMachine &target);
 
   void test();
-  void dump();
+  void dump() const;
 
 private:
-  std::map<std::string, InterferenceGraphNode> _graphMap;
+  unsigned int bitIndex(unsigned int a, unsigned int b) const;
+  // drops every edge of a node
+  void disconnectNode(unsigned int id);
+  // connects the nodes marked dirty to everything they interfere with. moves
+  // are only collected when the whole graph is being built.
+  template <typename SetType>
+  void connectRanges(const LiveRanges &ranges, const IlocProcedure &proc,
+                     LiveVariableAnalysisPass<SetType> &lvapass,
+                     const std::set<LiveRange> &infinites,
+                     const std::vector<bool> &dirty, bool build);
+  void weighRanges(const LiveRanges &ranges, const IlocProcedure &proc,
+                   const std::vector<unsigned int> &loopDepths,
+                   const std::set<LiveRange> &infinites,
+                   const std::vector<bool> &dirty);
+
+  std::vector<InterferenceGraphNode> _nodes;
+  BitVector _matrix;
+  std::vector<std::vector<unsigned int>> _neighbors;
+  std::vector<Move> _moves;
+  std::vector<unsigned int> _degrees;
+  std::vector<bool> _removed;
+  unsigned int _remaining = 0;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 
 template <typename SetType>
 void InterferenceGraph::createFromLiveRanges(
-    LiveRangesPass lrpass, IlocProcedure proc,
-    LiveVariableAnalysisPass<SetType> lvapass, std::set<LiveRange> infinites) {
+    LiveRangesPass &lrpass, const IlocProcedure &proc,
+    LiveVariableAnalysisPass<SetType> &lvapass,
+    const std::vector<unsigned int> &loopDepths,
+    const std::set<LiveRange> &infinites, const TargetMachine &target) {
 
-  _graphMap.clear();
-
-  std::set<LiveRange> set = lrpass.getLiveRanges(proc);
+  const LiveRanges &ranges = lrpass.getLiveRanges(proc);
+  std::vector<TargetMachine::RegisterClass> classes =
+      target.classifyRanges(proc, ranges);
 
   // initialize nodes
-  for (auto lr : set) {
-    addNode(lr.name);
+  reset(ranges.size());
+  for (const auto &lr : ranges.getRanges()) {
+    _nodes[lr.id].name = lr.name;
+    _nodes[lr.id].registerClass = classes[lr.id];
+    _nodes[lr.id].precolor = target.getReservedRegister(lr.name);
+  }
+
+  std::vector<bool> dirty(ranges.size(), true);
+  connectRanges(ranges, proc, lvapass, infinites, dirty, true);
+  weighRanges(ranges, proc, loopDepths, infinites, dirty);
+}
+
+template <typename SetType>
+void InterferenceGraph::updateNodes(
+    const std::vector<unsigned int> &ids, LiveRangesPass &lrpass,
+    const IlocProcedure &proc, LiveVariableAnalysisPass<SetType> &lvapass,
+    const std::vector<unsigned int> &loopDepths,
+    const std::set<LiveRange> &infinites) {
+
+  const LiveRanges &ranges = lrpass.getLiveRanges(proc);
+  if (ranges.size() != size()) {
+    throw "live ranges were renamed, the interference graph has to be "
+          "rebuilt.";
+  }
+
+  std::vector<bool> dirty(size(), false);
+  for (auto id : ids) {
+    dirty[id] = true;
+    disconnectNode(id);
+    _nodes[id].spillWeight = 0;
   }
 
-  // connect nodes
-  for (auto block : proc.orderedBlocks()) {
+  connectRanges(ranges, proc, lvapass, infinites, dirty, false);
+  weighRanges(ranges, proc, loopDepths, infinites, dirty);
+}
+
+template <typename SetType>
+void InterferenceGraph::connectRanges(
+    const LiveRanges &ranges, const IlocProcedure &proc,
+    LiveVariableAnalysisPass<SetType> &lvapass,
+    const std::set<LiveRange> &infinites, const std::vector<bool> &dirty,
+    bool build) {
+
+  auto isDirty = [&](const Value &value) {
+    return dirty[ranges.getRangeWithValue(value).id];
+  };
+
+  for (const auto &block : proc.orderedBlocks()) {
     std::unordered_set<Value> live = lvapass.getBlockSets(proc, block).out;
 
     // special case: if arguments haven't been spilled, they are always live
@@ -98,31 +191,57 @@ void InterferenceGraph::createFromLiveRanges(
     // them back into their registers before a return, so if they have been
     // spilled, we don't have to consider them live in register allocation.
     for (auto argValue : proc.getFrame().arguments) {
-      LiveRange argLiveRange = lrpass.getRangeWithValue(argValue, set);
+      const LiveRange &argLiveRange = ranges.getRangeWithValue(argValue);
       if (infinites.find(argLiveRange) == infinites.end()) {
         live.insert(argValue);
       }
     }
 
+    // a clean lvalue already has its edges to the other clean ranges, so it
+    // only needs the dirty values in live
+    std::unordered_set<Value> liveDirty;
+    if (!build) {
+      for (const auto &liveValue : live) {
+        if (isDirty(liveValue)) {
+          liveDirty.insert(liveValue);
+        }
+      }
+    }
+
     for (auto it = block.instructions.rbegin(); it != block.instructions.rend();
          it++) {
-      Instruction inst = *it;
+      const Instruction &inst = *it;
 
       // skip deleted
       if (inst.isDeleted())
         continue;
 
+      // a copy doesn't make its destination interfere with its source, so
+      // the two can be coalesced
+      bool isMove = inst.operation.opcode == ilocParser::I2I &&
+                    inst.operation.rvalues.front().getType() ==
+                        Value::Type::virtualReg;
+      if (build && isMove) {
+        addMove(ranges.getRangeWithValue(inst.operation.rvalues.front()).id,
+                ranges.getRangeWithValue(inst.operation.lvalues.front()).id);
+      }
+
       // lvalues interfere with anything in live
       for (auto lval : inst.operation.lvalues) {
         if (lval.getType() == Value::Type::virtualReg) {
-          LiveRange lvalLiveRange = lrpass.getRangeWithValue(lval, set);
+          const LiveRange &lvalLiveRange = ranges.getRangeWithValue(lval);
+
+          for (const auto &liveValue :
+               dirty[lvalLiveRange.id] ? live : liveDirty) {
+            if (isMove && liveValue == inst.operation.rvalues.front())
+              continue;
 
-          for (auto liveValue : live) {
-            connectNodes(lrpass.getRangeWithValue(liveValue, set).name,
-                         lvalLiveRange.name);
+            connectNodes(ranges.getRangeWithValue(liveValue).id,
+                         lvalLiveRange.id);
           }
 
           live.erase(lval);
+          liveDirty.erase(lval);
         }
       }
 
@@ -130,6 +249,9 @@ void InterferenceGraph::createFromLiveRanges(
       for (auto rval : inst.operation.rvalues) {
         if (rval.getType() == Value::Type::virtualReg) {
           live.insert(rval);
+          if (!build && isDirty(rval)) {
+            liveDirty.insert(rval);
+          }
         }
       }
     }
@@ -138,32 +260,8 @@ void InterferenceGraph::createFromLiveRanges(
   // arguments interfere with each other
   for (auto argVal1 : proc.getFrame().arguments) {
     for (auto argVal2 : proc.getFrame().arguments) {
-      connectNodes(lrpass.getRangeWithValue(argVal1, set).name,
-                   lrpass.getRangeWithValue(argVal2, set).name);
-    }
-  }
-
-  // record number of uses for spill costs
-  for (auto &pair : _graphMap) {
-    InterferenceGraphNode &node = pair.second;
-    LiveRange lr = lrpass.getRangeWithName(node.name, set);
-
-    // get number of uses for live range
-    unsigned int uses = 0;
-    for (auto val : lr.registers) {
-      if (proc.getSSAInfo().usesMap.find(val) !=
-          proc.getSSAInfo().usesMap.end()) {
-        uses += proc.getSSAInfo().usesMap.at(val).size();
-      } else {
-        // no uses. can happen with special registers.
-      }
-    }
-
-    node.uses = uses;
-
-    // set infinites
-    if (infinites.find(lr) != infinites.end()) {
-      node.infiniteCost = true;
+      connectNodes(ranges.getRangeWithValue(argVal1).id,
+                   ranges.getRangeWithValue(argVal2).id);
     }
   }
-}
\ No newline at end of file
+}
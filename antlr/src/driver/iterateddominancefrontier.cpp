@@ -0,0 +1,87 @@
+#include <algorithm>
+
+#include "iterateddominancefrontier.h"
+
+IteratedDominanceFrontier::IteratedDominanceFrontier(
+    const IlocProcedure &proc, const DominatorTree &tree)
+    : _dominatorEdges(tree.size()), _joinEdges(tree.size()),
+      _levels(tree.size(), 0), _inserted(tree.size(), 0),
+      _visited(tree.size(), 0), _inFrontier(tree.size(), 0), _query(0) {
+  // levels are depths in the dominator tree. the preorder visits parents
+  // before their children.
+  unsigned int maxLevel = 0;
+  for (auto id : tree.getPreorder()) {
+    if (id != tree.getRoot()) {
+      _levels[id] = _levels[tree.getParent(id)] + 1;
+      _dominatorEdges[tree.getParent(id)].push_back(id);
+    }
+    maxLevel = std::max(maxLevel, _levels[id]);
+  }
+
+  for (auto id : tree.getPreorder()) {
+    for (auto succ : proc.getBlock(id).after) {
+      if (tree.contains(succ) && tree.getParent(succ) != id) {
+        _joinEdges[id].push_back(succ);
+      }
+    }
+  }
+
+  _piggybank.resize(maxLevel + 1);
+}
+
+std::vector<unsigned int>
+IteratedDominanceFrontier::compute(const std::vector<unsigned int> &blocks) {
+  std::vector<unsigned int> frontier;
+  _query++;
+
+  for (auto id : blocks) {
+    insertNode(id);
+  }
+
+  // take nodes deepest first. a join edge only adds to the frontier if it
+  // doesn't lead below the level of the node the walk started from.
+  for (unsigned int level = _piggybank.size(); level-- > 0;) {
+    while (!_piggybank[level].empty()) {
+      unsigned int id = _piggybank[level].back();
+      _piggybank[level].pop_back();
+
+      _visited[id] = _query;
+      visit(id, level, frontier);
+    }
+  }
+
+  std::sort(frontier.begin(), frontier.end());
+  return frontier;
+}
+
+void IteratedDominanceFrontier::visit(unsigned int id, unsigned int rootLevel,
+                                      std::vector<unsigned int> &frontier) {
+  std::vector<unsigned int> stack = {id};
+
+  while (!stack.empty()) {
+    unsigned int current = stack.back();
+    stack.pop_back();
+
+    for (auto target : _joinEdges[current]) {
+      if (_levels[target] <= rootLevel && _inFrontier[target] != _query) {
+        _inFrontier[target] = _query;
+        frontier.push_back(target);
+        insertNode(target);
+      }
+    }
+
+    for (auto child : _dominatorEdges[current]) {
+      if (_visited[child] != _query) {
+        _visited[child] = _query;
+        stack.push_back(child);
+      }
+    }
+  }
+}
+
+void IteratedDominanceFrontier::insertNode(unsigned int id) {
+  if (_inserted[id] != _query) {
+    _inserted[id] = _query;
+    _piggybank[_levels[id]].push_back(id);
+  }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include "dominatortree.h"
+#include "ilocprocedure.h"
+
+// iterated dominance frontiers in time linear in the size of the cfg, using
+// sreedhar and gao's dj-graph walk. the dj-graph is built once per procedure
+// and shared by every query, so phi placement only pays for it once rather
+// than once per variable.
+class IteratedDominanceFrontier {
+public:
+  IteratedDominanceFrontier(const IlocProcedure &proc,
+                            const DominatorTree &tree);
+  // ids of the blocks in the iterated dominance frontier of the given blocks,
+  // in ascending order
+  std::vector<unsigned int>
+  compute(const std::vector<unsigned int> &blocks);
+
+private:
+  void visit(unsigned int id, unsigned int rootLevel,
+             std::vector<unsigned int> &frontier);
+  void insertNode(unsigned int id);
+
+  // dominator tree edges and cfg edges that aren't also tree edges
+  std::vector<std::vector<unsigned int>> _dominatorEdges;
+  std::vector<std::vector<unsigned int>> _joinEdges;
+  std::vector<unsigned int> _levels;
+
+  // per query state. marks are compared against the current query number so
+  // they never have to be cleared.
+  std::vector<std::vector<unsigned int>> _piggybank;
+  std::vector<unsigned int> _inserted;
+  std::vector<unsigned int> _visited;
+  std::vector<unsigned int> _inFrontier;
+  unsigned int _query;
+};
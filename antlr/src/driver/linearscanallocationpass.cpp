@@ -0,0 +1,470 @@
+#include <algorithm>
+
+#include "linearscanallocationpass.h"
+
+#include "spillcode.h"
+#include "spillcodecleaner.h"
+#include "spillslotallocator.h"
+
+LinearScanAllocationPass::LinearScanAllocationPass(
+    const TargetMachine &target)
+    : _target(target) {}
+
+void LinearScanAllocationPass::run(IlocProgram &prog) {
+  unsigned int iterations = 0;
+  bool dirtyProg = true;
+
+  std::cerr << "performing linear scan register allocation with "
+            << _target.describe() << "\n";
+
+  _offsetMap.clear();
+  _pieceMap.clear();
+  _argumentMap.clear();
+  _pieces = 0;
+  _spills = 0;
+  _removedMoves = 0;
+
+  std::unordered_map<std::string, std::vector<Interval>> intervalsMap;
+  std::unordered_map<std::string, bool> dirtyMap;
+  for (const auto &proc : prog.getProcedures()) {
+    _target.checkArguments(proc);
+    dirtyMap[proc.getFrame().name] = true;
+  }
+
+  LiveRangesPass lrpass(_target);
+  lrpass.run(prog);
+
+  while (dirtyProg == true) {
+    dirtyProg = false;
+    iterations++;
+
+    // liveness is only computed for the procedures that get asked about
+    LiveVariableAnalysisPass<HardValueSet> lvapass;
+
+    for (auto &proc : prog.getProceduresReference()) {
+      const std::string &name = proc.getFrame().name;
+      if (dirtyMap.at(name) == false)
+        continue;
+
+      const LiveRanges &ranges = lrpass.getLiveRanges(proc);
+      std::vector<Interval> intervals = buildIntervals(proc, ranges, lvapass);
+
+      // calls can't write back arguments their callees return over
+      std::vector<unsigned int> spills =
+          overwrittenRanges(proc, ranges, _target);
+      if (spills.empty()) {
+        spills = scan(intervals);
+      }
+      spillRanges(proc, ranges, spills);
+
+      // spilling renamed values, the ranges have to be found again
+      dirtyMap.at(name) = !spills.empty();
+      if (!spills.empty()) {
+        lrpass.update(proc);
+        dirtyProg = true;
+      }
+
+      intervalsMap[name] = std::move(intervals);
+    }
+  }
+
+  // spilled ranges that are never live at the same time can share a slot.
+  // once values are in registers, spill code moving a value to where it
+  // already is can go.
+  unsigned int removedLoads = 0;
+  unsigned int removedStores = 0;
+  for (auto &proc : prog.getProceduresReference()) {
+    std::set<unsigned int> offsets;
+    for (const auto &pair : _offsetMap[proc.getFrame().name]) {
+      offsets.insert(pair.second);
+    }
+
+    SpillSlotAllocator slotAllocator(proc, offsets);
+    slotAllocator.allocate();
+
+    // convert values to their registers
+    remapNames(proc, lrpass.getLiveRanges(proc),
+               intervalsMap.at(proc.getFrame().name));
+
+    SpillCodeCleaner cleaner(proc, offsets);
+    cleaner.clean();
+    removedLoads += cleaner.getRemovedLoads();
+    removedStores += cleaner.getRemovedStores();
+  }
+
+  std::cerr << iterations << " register allocation iterations.\n";
+  std::cerr << _spills << " live ranges spilled.\n";
+  std::cerr << _removedMoves << " moves removed.\n";
+  std::cerr << removedLoads << " spill loads and " << removedStores
+            << " spill stores removed.\n";
+}
+
+std::vector<LinearScanAllocationPass::Interval>
+LinearScanAllocationPass::buildIntervals(
+    const IlocProcedure &proc, const LiveRanges &ranges,
+    LiveVariableAnalysisPass<HardValueSet> &lvapass) {
+  const std::unordered_set<Value> &pieces = _pieceMap[proc.getFrame().name];
+  const std::unordered_set<Value> &spilledArguments =
+      _argumentMap[proc.getFrame().name];
+  unsigned int exitId = proc.getExitBlockId();
+  std::vector<TargetMachine::RegisterClass> classes =
+      _target.classifyRanges(proc, ranges);
+
+  // spilled arguments the return value overwrites aren't loaded back
+  std::unordered_set<Value> overwritten;
+  const std::vector<Value> arguments = proc.getFrame().arguments;
+  std::vector<bool> overwrittenArgs = overwrittenArguments(proc, _target);
+  for (unsigned int i = 0; i < arguments.size(); i++) {
+    const Value &argValue = arguments[i];
+    if (overwrittenArgs[i] &&
+        spilledArguments.find(argValue) != spilledArguments.end()) {
+      overwritten.insert(argValue);
+    }
+  }
+
+  std::vector<Interval> intervals(ranges.size());
+  for (unsigned int id = 0; id < ranges.size(); id++) {
+    const LiveRange &range = ranges.getRange(id);
+    Interval &interval = intervals[id];
+    interval.range = id;
+    interval.hint = none;
+    interval.registerClass = classes[id];
+    interval.spillable = true;
+    // the special registers keep their own
+    interval.reg = _target.getReservedRegister(range.name);
+
+    for (const auto &value : range.registers) {
+      if (pieces.find(value) != pieces.end() ||
+          spilledArguments.find(value) != spilledArguments.end()) {
+        interval.spillable = false;
+      }
+    }
+  }
+
+  auto addSegment = [&](const Value &value, unsigned int start,
+                        unsigned int end) {
+    intervals[ranges.getRangeWithValue(value).id].segments.push_back(
+        {start, end});
+  };
+
+  // every instruction takes two positions, rvalues are read at the first and
+  // lvalues written at the second. a range that dies at an instruction can
+  // share a register with one defined by it.
+  unsigned int position = 0;
+  for (const auto &block : proc.orderedBlocks()) {
+    unsigned int blockStart = position;
+    position += 2 * std::max<std::size_t>(block.instructions.size(), 1);
+    unsigned int blockEnd = position - 1;
+
+    // value -> last position it is live at
+    std::unordered_map<Value, unsigned int> open;
+    for (const auto &value : lvapass.getBlockSets(proc, block).out) {
+      open.insert({value, blockEnd});
+    }
+
+    // spilled arguments are loaded back into their registers on the way to
+    // the exit, and have to stay there
+    bool reachesExit =
+        block.id == exitId ||
+        std::find(block.after.begin(), block.after.end(), exitId) !=
+            block.after.end();
+    if (reachesExit) {
+      for (const auto &argValue : spilledArguments) {
+        if (overwritten.find(argValue) == overwritten.end()) {
+          open.insert({argValue, blockEnd});
+        }
+      }
+    }
+
+    for (int i = block.instructions.size() - 1; i >= 0; i--) {
+      const Instruction &inst = block.instructions[i];
+      if (inst.isDeleted())
+        continue;
+
+      unsigned int use = blockStart + 2 * i;
+
+      for (const auto &lval : inst.operation.lvalues) {
+        if (lval.getType() != Value::Type::virtualReg)
+          continue;
+
+        // a definition nobody reads still needs a register to write to
+        auto it = open.find(lval);
+        addSegment(lval, use + 1, it == open.end() ? use + 1 : it->second);
+        if (it != open.end()) {
+          open.erase(it);
+        }
+      }
+
+      for (const auto &rval : inst.operation.rvalues) {
+        if (rval.getType() == Value::Type::virtualReg) {
+          open.insert({rval, use});
+        }
+      }
+
+      if (inst.operation.opcode == ilocParser::I2I &&
+          inst.operation.rvalues.front().getType() ==
+              Value::Type::virtualReg) {
+        intervals[ranges.getRangeWithValue(inst.operation.lvalues.front()).id]
+            .hint =
+            ranges.getRangeWithValue(inst.operation.rvalues.front()).id;
+      }
+    }
+
+    for (const auto &pair : open) {
+      addSegment(pair.first, blockStart, pair.second);
+    }
+  }
+
+  // arguments that haven't been spilled are live everywhere because of call
+  // by reference
+  for (const auto &argValue : proc.getFrame().arguments) {
+    if (spilledArguments.find(argValue) == spilledArguments.end()) {
+      addSegment(argValue, 0, position);
+    }
+  }
+
+  for (auto &interval : intervals) {
+    std::vector<std::pair<unsigned int, unsigned int>> &segments =
+        interval.segments;
+    std::sort(segments.begin(), segments.end());
+
+    // merge segments that touch
+    std::vector<std::pair<unsigned int, unsigned int>> merged;
+    for (const auto &segment : segments) {
+      if (!merged.empty() && segment.first <= merged.back().second + 1) {
+        merged.back().second = std::max(merged.back().second, segment.second);
+      } else {
+        merged.push_back(segment);
+      }
+    }
+    segments = merged;
+  }
+
+  return intervals;
+}
+
+std::vector<unsigned int>
+LinearScanAllocationPass::scan(std::vector<Interval> &intervals) {
+  std::vector<Interval *> unhandled;
+  for (auto &interval : intervals) {
+    if (interval.reg == -1 && !interval.segments.empty()) {
+      unhandled.push_back(&interval);
+    }
+  }
+  std::sort(unhandled.begin(), unhandled.end(),
+            [](const Interval *a, const Interval *b) {
+              return a->start() != b->start() ? a->start() < b->start()
+                                              : a->range < b->range;
+            });
+
+  // active intervals are live at the current position, inactive ones are
+  // in a hole and may be live again later
+  std::vector<Interval *> active;
+  std::vector<Interval *> inactive;
+  std::vector<unsigned int> spills;
+
+  auto spill = [&](Interval *interval) {
+    interval->reg = -1;
+    spills.push_back(interval->range);
+    active.erase(std::remove(active.begin(), active.end(), interval),
+                 active.end());
+    inactive.erase(std::remove(inactive.begin(), inactive.end(), interval),
+                   inactive.end());
+  };
+
+  for (auto current : unhandled) {
+    unsigned int position = current->start();
+
+    // retire intervals that ended, and move the rest between active and
+    // inactive
+    std::vector<Interval *> stillActive;
+    std::vector<Interval *> stillInactive;
+    for (auto interval : active) {
+      if (interval->end() < position)
+        continue;
+      (interval->covers(position) ? stillActive : stillInactive)
+          .push_back(interval);
+    }
+    for (auto interval : inactive) {
+      if (interval->end() < position)
+        continue;
+      (interval->covers(position) ? stillActive : stillInactive)
+          .push_back(interval);
+    }
+    active = stillActive;
+    inactive = stillInactive;
+
+    // registers held by anything that overlaps the current interval
+    std::vector<std::vector<Interval *>> holders(_target.getTotalRegisters());
+    for (auto interval : active) {
+      holders[interval->reg].push_back(interval);
+    }
+    for (auto interval : inactive) {
+      if (interval->intersects(*current)) {
+        holders[interval->reg].push_back(interval);
+      }
+    }
+
+    // the reserved registers of the class are never handed out
+    TargetMachine::RegisterClass cls = current->registerClass;
+    unsigned int first = _target.getFirstAllocatable(cls);
+    unsigned int end = _target.getEndRegister(cls);
+    int reg = -1;
+    if (current->hint != none &&
+        _target.isAllocatable(cls, intervals[current->hint].reg) &&
+        holders[intervals[current->hint].reg].empty()) {
+      reg = intervals[current->hint].reg;
+    }
+    for (unsigned int r = first; r < end && reg == -1; r++) {
+      if (holders[r].empty()) {
+        reg = r;
+      }
+    }
+
+    if (reg == -1) {
+      // no free register. take the one whose holders stay live the longest,
+      // unless the current interval outlives them.
+      unsigned int furthest = 0;
+      for (unsigned int r = first; r < end; r++) {
+        bool evictable = true;
+        unsigned int last = 0;
+        for (auto holder : holders[r]) {
+          evictable = evictable && holder->spillable;
+          last = std::max(last, holder->end());
+        }
+
+        if (evictable && (reg == -1 || last > furthest)) {
+          reg = r;
+          furthest = last;
+        }
+      }
+
+      if (current->spillable && (reg == -1 || current->end() >= furthest)) {
+        spills.push_back(current->range);
+        continue;
+      }
+      // only pieces and spilled arguments are left in the way. they're live
+      // just around the instruction that references them, or at the entry
+      // and the return, which always fit.
+      if (reg == -1) {
+        throw "an instruction references more values than there are "
+              "registers.";
+      }
+
+      std::vector<Interval *> evicted = holders[reg];
+      for (auto holder : evicted) {
+        spill(holder);
+      }
+    }
+
+    current->reg = reg;
+    active.push_back(current);
+  }
+
+  return spills;
+}
+
+void LinearScanAllocationPass::spillRanges(
+    IlocProcedure &proc, const LiveRanges &ranges,
+    const std::vector<unsigned int> &ids) {
+  // range id -> stack offset. rematerialized ranges don't need one.
+  std::unordered_map<unsigned int, unsigned int> offsets;
+  for (auto id : ids) {
+    const LiveRange &range = ranges.getRange(id);
+    if (!range.remat) {
+      offsets[id] = growFrame(proc);
+      _offsetMap[proc.getFrame().name][range.name] = offsets[id];
+    }
+    _spills++;
+  }
+
+  spillLiveRanges(proc, ranges, ids, offsets, _pieceMap[proc.getFrame().name],
+                  _pieces, _target);
+
+  std::unordered_set<unsigned int> spilled(ids.begin(), ids.end());
+  for (const auto &argValue : proc.getFrame().arguments) {
+    unsigned int id = ranges.getRangeWithValue(argValue).id;
+    if (spilled.find(id) != spilled.end()) {
+      spillArgument(proc, argValue, offsets.at(id), _target);
+      _argumentMap[proc.getFrame().name].insert(argValue);
+    }
+  }
+}
+
+void LinearScanAllocationPass::remapNames(
+    IlocProcedure &proc, const LiveRanges &ranges,
+    const std::vector<Interval> &intervals) {
+  auto remap = [&](Value &value) {
+    if (value.getType() != Value::Type::virtualReg)
+      return;
+
+    int reg = intervals[ranges.getRangeWithValue(value).id].reg;
+    value.setSubscript(value.getFullText());
+    value.setName("%vr" + std::to_string(reg));
+  };
+
+  for (auto &arg : proc.getFrameReference().arguments) {
+    remap(arg);
+  }
+
+  for (auto &block : proc.orderedBlocksReference()) {
+    for (auto &inst : block.instructions) {
+      if (inst.isDeleted())
+        continue;
+
+      for (auto &lval : inst.operation.lvalues) {
+        remap(lval);
+      }
+      for (auto &rval : inst.operation.rvalues) {
+        remap(rval);
+      }
+
+      // copies between ranges that ended up in the same register do nothing
+      if (inst.operation.opcode == ilocParser::I2I && inst.label == "" &&
+          inst.operation.rvalues.front().getName() ==
+              inst.operation.lvalues.front().getName()) {
+        inst.markAsDeleted();
+        _removedMoves++;
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int LinearScanAllocationPass::Interval::start() const {
+  return segments.front().first;
+}
+
+unsigned int LinearScanAllocationPass::Interval::end() const {
+  return segments.back().second;
+}
+
+bool LinearScanAllocationPass::Interval::covers(unsigned int pos) const {
+  for (const auto &segment : segments) {
+    if (segment.first <= pos && pos <= segment.second) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LinearScanAllocationPass::Interval::intersects(
+    const Interval &other) const {
+  // walk both sorted segment lists together
+  unsigned int i = 0;
+  unsigned int j = 0;
+  while (i < segments.size() && j < other.segments.size()) {
+    const auto &a = segments[i];
+    const auto &b = other.segments[j];
+    if (a.first <= b.second && b.first <= a.second) {
+      return true;
+    }
+    if (a.second < b.second) {
+      i++;
+    } else {
+      j++;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "liverangespass.h"
+#include "livevariableanalysispass.h"
+#include "pass.h"
+#include "targetmachine.h"
+
+// register allocation by linear scan, as a faster alternative to graph
+// coloring. instructions are numbered in block order and every live range
+// gets the positions where it is live as a list of segments, keeping the
+// holes between them like traub's second chance binpacking. ranges are
+// visited by start position and take a register that is free for their whole
+// lifetime. when none is, either the range itself or the ranges holding the
+// register that stay live the longest are spilled. spilled ranges are split
+// around each of their references, and the scan is repeated until nothing
+// has to be spilled.
+//
+// a return reads the return value along with every argument, which can take
+// more registers than there are. the last arguments are then left to the
+// return value once they're spilled, and calls don't write them back (see
+// spillcode.h).
+//
+// copies aren't coalesced, a range just prefers the register of the copy that
+// defines it. a range only takes registers of its own class.
+class LinearScanAllocationPass : public Pass {
+public:
+  LinearScanAllocationPass(const TargetMachine &target);
+  void run(IlocProgram &prog);
+
+private:
+  struct Interval {
+    // live range id
+    unsigned int range;
+    // inclusive [start, end] positions, sorted and disjoint
+    std::vector<std::pair<unsigned int, unsigned int>> segments;
+    // range whose register this one would like to share, none if there is
+    // no preference
+    unsigned int hint;
+    TargetMachine::RegisterClass registerClass;
+    bool spillable;
+    int reg;
+
+    unsigned int start() const;
+    unsigned int end() const;
+    bool covers(unsigned int pos) const;
+    bool intersects(const Interval &other) const;
+  };
+
+  std::vector<Interval>
+  buildIntervals(const IlocProcedure &proc, const LiveRanges &ranges,
+                 LiveVariableAnalysisPass<HardValueSet> &lvapass);
+  std::vector<unsigned int> scan(std::vector<Interval> &intervals);
+  void spillRanges(IlocProcedure &proc, const LiveRanges &ranges,
+                   const std::vector<unsigned int> &ids);
+  void remapNames(IlocProcedure &proc, const LiveRanges &ranges,
+                  const std::vector<Interval> &intervals);
+
+  static const unsigned int none = std::numeric_limits<unsigned int>::max();
+
+  const TargetMachine &_target;
+
+  // procedure name -> live range name -> stack offset
+  std::unordered_map<std::string, std::unordered_map<std::string, unsigned int>>
+      _offsetMap;
+  // procedure name -> values that were split off of spilled ranges. they
+  // are as small as they can get, so they can't be spilled again.
+  std::unordered_map<std::string, std::unordered_set<Value>> _pieceMap;
+  // procedure name -> arguments that were spilled
+  std::unordered_map<std::string, std::unordered_set<Value>> _argumentMap;
+  unsigned int _pieces;
+  unsigned int _spills;
+  unsigned int _removedMoves;
+};
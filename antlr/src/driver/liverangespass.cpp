@@ -3,6 +3,7 @@
 #include "interferencegraph.h"
 #include "liverangespass.h"
 #include "livevariableanalysispass.h"
+#include "unionfind.h"
 #include "usesanddefinitionspass.h"
 
 bool operator==(const LiveRange &a, const LiveRange &b) {
@@ -13,100 +14,164 @@ bool operator<(const LiveRange &a, const LiveRange &b) {
   return a.name < b.name;
 }
 
-LiveRange::LiveRange(Value v) {
-  name = v.getFullText();
-  registers.insert(v);
+const std::vector<LiveRange> &LiveRanges::getRanges() const {
+  return _ranges;
 }
 
-void LiveRange::assimilateRanges(std::set<LiveRange> ranges) {
-  for (auto lr : ranges) {
-    registers.insert(lr.registers.begin(), lr.registers.end());
+unsigned int LiveRanges::size() const { return _ranges.size(); }
+
+const LiveRange &LiveRanges::getRange(unsigned int id) const {
+  return _ranges.at(id);
+}
+
+const LiveRange &LiveRanges::getRangeWithValue(const Value &val) const {
+  auto it = _valueRanges.find(val);
+  if (it == _valueRanges.end()) {
+    throw "value " + val.getFullText() + " isn't in a live range";
+  }
+  return _ranges[it->second];
+}
+
+const LiveRange &LiveRanges::getRangeWithName(const std::string &name) const {
+  auto it = _nameRanges.find(name);
+  if (it == _nameRanges.end()) {
+    throw "no live range named " + name;
   }
+  return _ranges[it->second];
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-IlocProgram LiveRangesPass::applyToProgram(IlocProgram prog) {
+LiveRangesPass::LiveRangesPass(const TargetMachine &target)
+    : _target(target) {}
+
+void LiveRangesPass::run(IlocProgram &prog) {
   if (!prog.isSSA()) {
     throw "can't operate on non-ssa program!";
   }
 
   UsesAndDefinitionsPass udpass;
-  prog = udpass.applyToProgram(prog);
+  udpass.run(prog);
 
   _rangesMap.clear();
 
-  for (auto proc : prog.getProcedures()) {
-    _rangesMap.insert({proc, computeLiveRanges(proc)});
+  for (const auto &proc : prog.getProcedures()) {
+    _rangesMap.insert({proc.getFrame().name, computeLiveRanges(proc)});
   }
+}
+
+void LiveRangesPass::update(IlocProcedure &proc) {
+  UsesAndDefinitionsPass udpass;
+  udpass.calculateSSAInfo(proc);
 
-  return prog;
+  _rangesMap.erase(proc.getFrame().name);
+  _rangesMap.insert({proc.getFrame().name, computeLiveRanges(proc)});
 }
 
-std::set<LiveRange> LiveRangesPass::getLiveRanges(IlocProcedure proc) {
-  if (_rangesMap.find(proc) == _rangesMap.end()) {
-    computeLiveRanges(proc);
+const LiveRanges &LiveRangesPass::getLiveRanges(const IlocProcedure &proc) {
+  const std::string &name = proc.getFrame().name;
+  if (_rangesMap.find(name) == _rangesMap.end()) {
+    _rangesMap.insert({name, computeLiveRanges(proc)});
   }
 
-  return _rangesMap.at(proc);
+  return _rangesMap.at(name);
 }
 
-std::set<LiveRange> LiveRangesPass::computeLiveRanges(IlocProcedure proc) {
-  std::set<LiveRange> rangesSet;
+LiveRanges LiveRangesPass::computeLiveRanges(const IlocProcedure &proc) {
+  // number each register and start it off in its own live range
+  std::vector<Value> values;
+  std::unordered_map<Value, unsigned int> valueIds;
+  UnionFind sets;
+  // representative -> register the range is named after
+  std::vector<unsigned int> names;
+
+  auto number = [&](const Value &value) {
+    auto it = valueIds.find(value);
+    if (it != valueIds.end()) {
+      return it->second;
+    }
+
+    unsigned int id = sets.add();
+    valueIds.insert({value, id});
+    values.push_back(value);
+    names.push_back(id);
+    return id;
+  };
 
-  // initialize each register into its own live range
-  for (auto pair : proc.getSSAInfo().definitionsMap) {
-    rangesSet.insert(LiveRange(pair.first));
+  for (const auto &pair : proc.getSSAInfo().definitionsMap) {
+    number(pair.first);
   }
 
-  for (auto block : proc.orderedBlocks()) {
+  // merged ranges keep the name of the range being merged into. phi operands
+  // may have lost their definitions to live range splitting, so they are
+  // numbered as they're found.
+  auto merge = [&](const Value &to, const Value &from) {
+    unsigned int toRoot = sets.find(number(to));
+    unsigned int name = names[toRoot];
+    names[sets.unite(toRoot, number(from))] = name;
+  };
+
+  for (const auto &block : proc.orderedBlocks()) {
     // merge live ranges at phi nodes
-    for (auto phi : block.phinodes) {
+    for (const auto &phi : block.phinodes) {
       if (phi.isDeleted())
         continue;
 
-      // merge rvalue ranges
-      for (auto pair : phi.getRValueMap()) {
-        // add rvalue live range to merge set
-        Value rval = pair.second;
-        mergeLiveRangesWithValues(phi.getLValue(), rval, rangesSet);
+      for (const auto &pair : phi.getRValueMap()) {
+        merge(phi.getLValue(), pair.second);
       }
     }
 
     // function calls merge the live ranges of their arguments with their
     // corresponding lvalues because of call by reference
-    for (auto inst : block.instructions) {
+    for (const auto &inst : block.instructions) {
       if (inst.isDeleted()) {
         continue;
       }
 
-      if (inst.operation.opcode == ilocParser::CALL ||
-          inst.operation.opcode == ilocParser::ICALL ||
-          inst.operation.opcode == ilocParser::FCALL) {
-
-        int lValueIndex = 0;
-        if (inst.operation.opcode == ilocParser::ICALL ||
-            inst.operation.opcode == ilocParser::FCALL) {
-          // functions with return values have one extra lvalue
-          lValueIndex++;
-        }
-
-        // merge arguments with their definitions
-        for (auto rval : inst.operation.rvalues) {
-          // skip the function name
-          if (rval.getType() == Value::Type::label)
-            continue;
-
-          mergeLiveRangesWithValues(rval, inst.operation.lvalues[lValueIndex],
-                                    rangesSet);
-          lValueIndex++;
-        }
+      // merge arguments with their definitions
+      const Operation &op = inst.operation;
+      for (const auto &pair : op.getWrittenArguments()) {
+        merge(op.rvalues[pair.first], op.lvalues[pair.second]);
       }
     }
   }
 
+  // give the ranges ids in name order
+  std::vector<unsigned int> roots;
+  for (unsigned int i = 0; i < values.size(); i++) {
+    if (sets.find(i) == i) {
+      roots.push_back(i);
+    }
+  }
+  std::vector<std::string> rootNames(values.size());
+  for (auto root : roots) {
+    rootNames[root] = values[names[root]].getFullText();
+  }
+  std::sort(roots.begin(), roots.end(), [&](unsigned int a, unsigned int b) {
+    return rootNames[a] < rootNames[b];
+  });
+
+  LiveRanges ranges;
+  std::vector<unsigned int> rangeIds(values.size());
+  for (auto root : roots) {
+    rangeIds[root] = ranges._ranges.size();
+    ranges._nameRanges.insert({rootNames[root], ranges._ranges.size()});
+    ranges._ranges.push_back(
+        {rootNames[root], {}, rangeIds[root], nullptr});
+  }
+
+  // flatten the sets so lookups don't have to walk them
+  for (unsigned int i = 0; i < values.size(); i++) {
+    unsigned int id = rangeIds[sets.find(i)];
+    ranges._ranges[id].registers.insert(values[i]);
+    ranges._valueRanges.insert({values[i], id});
+  }
+
+  tagRematerializable(proc, ranges);
+
   // debug output
-  // for (auto lr : rangesSet) {
+  // for (const auto &lr : ranges.getRanges()) {
   //   std::cerr << "found " << lr.name << std::endl;
   //   std::cerr << "    ";
   //   for (auto val : lr.registers) {
@@ -115,54 +180,63 @@ std::set<LiveRange> LiveRangesPass::computeLiveRanges(IlocProcedure proc) {
   //   std::cerr << std::endl;
   // }
 
-  return rangesSet;
+  return ranges;
 }
 
-LiveRange LiveRangesPass::getRangeWithValue(Value val,
-                                            std::set<LiveRange> rangesSet) {
-  return *std::find_if(rangesSet.begin(), rangesSet.end(), [&](LiveRange l) {
-    for (auto innerValue : l.registers) {
-      if (innerValue.getFullText() == val.getFullText())
-        return true;
-    }
-    return false;
-  });
-}
+void LiveRangesPass::tagRematerializable(const IlocProcedure &proc,
+                                         LiveRanges &ranges) {
+  const auto &definitions = proc.getSSAInfo().definitionsMap;
 
-LiveRange LiveRangesPass::getRangeWithName(std::string name,
-                                           std::set<LiveRange> rangesSet) {
-  return *std::find_if(rangesSet.begin(), rangesSet.end(), [&](LiveRange l) {
-    for (auto innerValue : l.registers) {
-      if (innerValue.getFullText() == name)
-        return true;
+  // loadI of a constant or label, or an address off of the frame pointer or
+  // another special register, which are never handed out and so keep their
+  // value
+  auto rematerializable = [&](const Operation &op) {
+    if (op.opcode == ilocParser::LOADI) {
+      return true;
     }
-    return false;
-  });
-}
-
-void LiveRangesPass::mergeLiveRangesWithValues(Value to, Value from,
-                                               std::set<LiveRange> &set) {
-  // get live range associated with lvalue
-  LiveRange toRange = getRangeWithValue(to, set);
+    return op.opcode == ilocParser::ADDI &&
+           _target.getReservedRegister(op.rvalues[0].getFullText()) != -1 &&
+           op.rvalues[1].getType() == Value::Type::number;
+  };
+
+  for (auto &range : ranges._ranges) {
+    // values merged at phis carry their operands' tags, so only the
+    // instructions defining the range have to agree
+    std::unique_ptr<Operation> tag;
+    bool valid = true;
+
+    for (const auto &value : range.registers) {
+      auto it = definitions.find(value);
+      if (it == definitions.end()) {
+        valid = false;
+        break;
+      }
+      if (it->second->tag == ValueOccurance::Tag::phinode)
+        continue;
+      if (it->second->tag != ValueOccurance::Tag::instruction) {
+        valid = false;
+        break;
+      }
 
-  // create a set of ranges that we will merge with the lvalue range
-  std::set<LiveRange> toMerge;
+      Operation op =
+          std::static_pointer_cast<InstructionValueOccurance>(it->second)
+              ->inst.operation;
+      if (!rematerializable(op)) {
+        valid = false;
+        break;
+      }
 
-  // save rvalues to merge set
-  LiveRange fromRange = getRangeWithValue(from, set);
-  toMerge.insert(fromRange);
+      op.lvalues.clear();
+      if (!tag) {
+        tag.reset(new Operation(op));
+      } else if (!(*tag == op)) {
+        valid = false;
+        break;
+      }
+    }
 
-  // erase ranges in toMerge from master set
-  for (auto mergingRange : toMerge) {
-    set.erase(mergingRange);
+    if (valid && tag) {
+      range.remat = std::move(tag);
+    }
   }
-
-  // remove range before modification
-  set.erase(toRange);
-
-  // merge
-  toRange.assimilateRanges(toMerge);
-
-  // save
-  set.insert(toRange);
-}
\ No newline at end of file
+}
@@ -1,12 +1,20 @@
 #pragma once
 
+#include <memory>
+
 #include "pass.h"
 
+class TargetMachine;
+
 struct LiveRange {
-  explicit LiveRange(Value v);
-  void assimilateRanges(std::set<LiveRange> ranges);
   std::string name;
   std::set<Value> registers;
+  // index of the range in its procedure's LiveRanges
+  unsigned int id;
+  // if every definition of the range computes the same value from operands
+  // that are never redefined, the operation that computes it, without its
+  // lvalue. such a range can be recomputed instead of stored and loaded.
+  std::shared_ptr<const Operation> remat;
 };
 
 bool operator==(const LiveRange &a, const LiveRange &b);
@@ -21,17 +29,37 @@ template <> struct hash<LiveRange> {
 
 } // namespace std
 
+// the live ranges of one procedure, ordered by name and indexed by id
+class LiveRanges {
+  friend class LiveRangesPass;
+
+public:
+  const std::vector<LiveRange> &getRanges() const;
+  unsigned int size() const;
+  // constant time lookups
+  const LiveRange &getRange(unsigned int id) const;
+  const LiveRange &getRangeWithValue(const Value &val) const;
+  const LiveRange &getRangeWithName(const std::string &name) const;
+
+private:
+  std::vector<LiveRange> _ranges;
+  std::unordered_map<Value, unsigned int> _valueRanges;
+  std::unordered_map<std::string, unsigned int> _nameRanges;
+};
+
 class LiveRangesPass : public Pass {
 public:
-  IlocProgram applyToProgram(IlocProgram prog);
-  std::set<LiveRange> getLiveRanges(IlocProcedure proc);
-  LiveRange getRangeWithValue(Value val, std::set<LiveRange> rangesSet);
-  LiveRange getRangeWithName(std::string name, std::set<LiveRange> rangesSet);
+  LiveRangesPass(const TargetMachine &target);
+  void run(IlocProgram &prog);
+  // recomputes the ranges of one procedure after its code changed
+  void update(IlocProcedure &proc);
+  const LiveRanges &getLiveRanges(const IlocProcedure &proc);
 
 private:
-  std::set<LiveRange> computeLiveRanges(IlocProcedure proc);
-  void mergeLiveRangesWithValues(Value to, Value from,
-                                 std::set<LiveRange> &set);
+  LiveRanges computeLiveRanges(const IlocProcedure &proc);
+  void tagRematerializable(const IlocProcedure &proc, LiveRanges &ranges);
 
-  std::unordered_map<IlocProcedure, std::set<LiveRange>> _rangesMap;
+  const TargetMachine &_target;
+  // procedure name -> ranges
+  std::unordered_map<std::string, LiveRanges> _rangesMap;
 };
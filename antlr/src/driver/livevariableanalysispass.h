@@ -2,6 +2,8 @@
 
 #include <set>
 
+#include "bitvector.h"
+#include "dataflowsolver.h"
 #include "pass.h"
 #include "value.h"
 
@@ -21,18 +23,57 @@ template <typename SetType> class LiveVariableAnalysisPass : public Pass {
                          const LiveVariableAnalysisPass<T> &b);
 
 public:
-  IlocProgram applyToProgram(IlocProgram prog);
-  DataFlowSets<SetType> getBlockSets(IlocProcedure proc, BasicBlock block);
+  void run(IlocProgram &prog);
+  const DataFlowSets<SetType> &getBlockSets(const IlocProcedure &proc,
+                                            const BasicBlock &block);
+  // solves a procedure again for some of its registers only, after code that
+  // references nothing else was added or removed. every other register keeps
+  // its sets.
+  void update(const IlocProcedure &proc, const SetType &registers);
+  // the procedure's sets are computed again the next time they're asked for
+  void invalidate(const IlocProcedure &proc);
   void dump() const;
 
 private:
-  void analizeProcedure(IlocProcedure proc);
-  void computeSets(IlocProcedure proc, BasicBlock block);
+  // registers are numbered densely, with registers that SetType considers
+  // equal sharing a number, so sets can be solved as bit vectors
+  using RegisterNumbers = std::unordered_map<Value, unsigned int,
+                                             typename SetType::hasher,
+                                             typename SetType::key_equal>;
+
+  // liveness as a backward union problem over register numbers
+  class Problem {
+  public:
+    struct Summary {
+      BitVector gen;
+      BitVector not_prsv;
+    };
+    using Lattice = BitVector;
+    static const DataFlowDirection direction = DataFlowDirection::backward;
+
+    Problem(const RegisterNumbers &numbers);
+    Summary summarize(const BasicBlock &block);
+    Lattice top();
+    Lattice boundary();
+    void meet(Lattice &into, const Lattice &from);
+    bool transfer(const Summary &summary, const Lattice &out, Lattice &in);
+
+  private:
+    const RegisterNumbers &_numbers;
+  };
+
+  void analizeProcedure(const IlocProcedure &proc);
+  // numbers only the registers in only, if it's given
+  void numberRegisters(const IlocProcedure &proc, RegisterNumbers &numbers,
+                       std::vector<Value> &registers,
+                       const SetType *only = nullptr);
+  SetType materialize(const BitVector &bits,
+                      const std::vector<Value> &registers);
 
   unsigned int _iterations;
 
-  std::unordered_map<IlocProcedure,
-                     std::unordered_map<BasicBlock, DataFlowSets<SetType>>>
+  // procedure name -> sets for each block, indexed by block id
+  std::unordered_map<std::string, std::vector<DataFlowSets<SetType>>>
       _setsMap;
 };
 
@@ -76,133 +117,193 @@ bool operator!=(const DataFlowSets<SetType> &a,
 }
 
 template <typename SetType>
-IlocProgram
-LiveVariableAnalysisPass<SetType>::applyToProgram(IlocProgram prog) {
+void LiveVariableAnalysisPass<SetType>::run(IlocProgram &prog) {
   _setsMap.clear();
-  for (auto proc : prog.getProcedures()) {
+  for (const auto &proc : prog.getProcedures()) {
     analizeProcedure(proc);
   }
-
-  return prog;
 }
 
 template <typename SetType>
-DataFlowSets<SetType>
-LiveVariableAnalysisPass<SetType>::getBlockSets(IlocProcedure proc,
-                                                BasicBlock block) {
-  if (_setsMap.find(proc) == _setsMap.end()) {
+const DataFlowSets<SetType> &
+LiveVariableAnalysisPass<SetType>::getBlockSets(const IlocProcedure &proc,
+                                                const BasicBlock &block) {
+  const std::string &name = proc.getFrame().name;
+  if (_setsMap.find(name) == _setsMap.end()) {
     analizeProcedure(proc);
   }
 
-  if (_setsMap.at(proc).find(block) == _setsMap.at(proc).end()) {
+  if (_setsMap.at(name).size() != proc.orderedBlocks().size()) {
     analizeProcedure(proc);
   }
 
-  return _setsMap.at(proc).at(block);
+  return _setsMap.at(name).at(block.id);
 }
 
 template <typename SetType>
-void LiveVariableAnalysisPass<SetType>::analizeProcedure(IlocProcedure proc) {
-  // visit each node
-  std::stack<BasicBlock> workStack;
-  std::stack<BasicBlock> visitStack;
-  std::unordered_set<BasicBlock> visited;
+void LiveVariableAnalysisPass<SetType>::update(const IlocProcedure &proc,
+                                               const SetType &registers) {
+  auto it = _setsMap.find(proc.getFrame().name);
+  if (it == _setsMap.end() ||
+      it->second.size() != proc.orderedBlocks().size()) {
+    analizeProcedure(proc);
+    return;
+  }
 
-  visitStack.push(proc.getBlock("entry"));
-  workStack.push(proc.getBlock("entry"));
+  // liveness of one register doesn't depend on any other, so the rest of
+  // the registers can be left out of the problem
+  RegisterNumbers numbers;
+  std::vector<Value> numbered;
+  numberRegisters(proc, numbers, numbered, &registers);
 
-  // build workstack depth first
-  while (!visitStack.empty()) {
-    BasicBlock block = visitStack.top();
-    visitStack.pop();
-    visited.insert(block);
+  Problem problem(numbers);
+  DataFlowSolver<Problem> solver(problem);
+  solver.solve(proc);
+  _iterations = solver.getIterations(); // for debug purposes
 
-    for (auto successorBlockName : block.after) {
-      BasicBlock successorBlock = proc.getBlock(successorBlockName);
-      if (visited.find(successorBlock) == visited.end()) {
-        // block hasn't been visited
-        workStack.push(successorBlock);
-        visitStack.push(successorBlock);
-      }
+  auto replace = [&](SetType &set, const BitVector &bits) {
+    for (const auto &reg : registers) {
+      set.erase(reg);
     }
+    bits.forEach([&](unsigned int reg) { set.insert(numbered[reg]); });
+  };
+
+  auto &sets = it->second;
+  for (unsigned int id = 0; id < sets.size(); id++) {
+    replace(sets[id].in, solver.getIn(id));
+    replace(sets[id].gen, solver.getSummary(id).gen);
+    replace(sets[id].not_prsv, solver.getSummary(id).not_prsv);
+    replace(sets[id].out, solver.getOut(id));
   }
+}
 
-  // process blocks
-  bool dirty = true;
-  _iterations = 0; // for debug purposes
+template <typename SetType>
+void LiveVariableAnalysisPass<SetType>::invalidate(const IlocProcedure &proc) {
+  _setsMap.erase(proc.getFrame().name);
+}
 
-  while (dirty == true) {
-    dirty = false;
-    _iterations++;
-    std::stack<BasicBlock> currentStack = workStack;
-    while (!currentStack.empty()) {
-      BasicBlock block = currentStack.top();
-      currentStack.pop();
+template <typename SetType>
+void LiveVariableAnalysisPass<SetType>::analizeProcedure(
+    const IlocProcedure &proc) {
+  RegisterNumbers numbers;
+  std::vector<Value> registers;
+  numberRegisters(proc, numbers, registers);
+
+  Problem problem(numbers);
+  DataFlowSolver<Problem> solver(problem);
+  solver.solve(proc);
+  _iterations = solver.getIterations(); // for debug purposes
+
+  // hand out results as sets
+  auto &sets = _setsMap[proc.getFrame().name];
+  sets.assign(proc.orderedBlocks().size(), DataFlowSets<SetType>());
+  for (unsigned int id = 0; id < sets.size(); id++) {
+    sets[id].in = materialize(solver.getIn(id), registers);
+    sets[id].gen = materialize(solver.getSummary(id).gen, registers);
+    sets[id].not_prsv = materialize(solver.getSummary(id).not_prsv, registers);
+    sets[id].out = materialize(solver.getOut(id), registers);
+  }
+}
+
+template <typename SetType>
+void LiveVariableAnalysisPass<SetType>::numberRegisters(
+    const IlocProcedure &proc, RegisterNumbers &numbers,
+    std::vector<Value> &registers, const SetType *only) {
+  auto number = [&](const Value &value) {
+    if (value.getType() == Value::Type::virtualReg &&
+        numbers.find(value) == numbers.end() &&
+        (only == nullptr || only->find(value) != only->end())) {
+      numbers.insert({value, registers.size()});
+      registers.push_back(value);
+    }
+  };
 
-      DataFlowSets<SetType> oldset = _setsMap[proc][block];
-      computeSets(proc, block);
-      DataFlowSets<SetType> newset = _setsMap[proc][block];
+  for (const auto &block : proc.orderedBlocks()) {
+    for (const auto &inst : block.instructions) {
+      if (inst.isDeleted())
+        continue;
 
-      if (oldset.in != newset.in || oldset.out != newset.out)
-        dirty = true;
+      for (const auto &rvalue : inst.operation.rvalues) {
+        number(rvalue);
+      }
+      for (const auto &lvalue : inst.operation.lvalues) {
+        number(lvalue);
+      }
     }
   }
 }
 
 template <typename SetType>
-void LiveVariableAnalysisPass<SetType>::computeSets(IlocProcedure proc,
-                                                    BasicBlock block) {
-  DataFlowSets<SetType> &currentSet = _setsMap.at(proc).at(block);
+LiveVariableAnalysisPass<SetType>::Problem::Problem(
+    const RegisterNumbers &numbers)
+    : _numbers(numbers) {}
 
-  currentSet.gen.clear();
-  currentSet.not_prsv.clear();
-
-  // local info
-  for (auto inst : block.instructions) {
+template <typename SetType>
+typename LiveVariableAnalysisPass<SetType>::Problem::Summary
+LiveVariableAnalysisPass<SetType>::Problem::summarize(
+    const BasicBlock &block) {
+  Summary summary = {top(), top()};
+  for (const auto &inst : block.instructions) {
     if (inst.isDeleted())
       continue;
 
-    for (auto rvalue : inst.operation.rvalues) {
-      if (rvalue.getType() == Value::Type::virtualReg &&
-          currentSet.not_prsv.find(rvalue) == currentSet.not_prsv.end()) {
-        currentSet.gen.insert(rvalue);
+    // registers that weren't numbered are left out of the problem
+    for (const auto &rvalue : inst.operation.rvalues) {
+      auto it = _numbers.find(rvalue);
+      if (it != _numbers.end() && !summary.not_prsv.test(it->second)) {
+        summary.gen.set(it->second);
       }
     }
-    for (auto lvalue : inst.operation.lvalues) {
-      if (lvalue.getType() == Value::Type::virtualReg) {
-        currentSet.not_prsv.insert(lvalue);
+    for (const auto &lvalue : inst.operation.lvalues) {
+      auto it = _numbers.find(lvalue);
+      if (it != _numbers.end()) {
+        summary.not_prsv.set(it->second);
       }
     }
   }
+  return summary;
+}
 
-  // out
-  currentSet.out.clear();
-  for (auto blockName : block.after) {
-    BasicBlock successor = proc.getBlock(blockName);
-    for (auto value : _setsMap[proc][successor].in) {
-      _setsMap[proc][block].out.insert(value);
-    }
-  }
+template <typename SetType>
+BitVector LiveVariableAnalysisPass<SetType>::Problem::top() {
+  return BitVector(_numbers.size());
+}
 
-  // in
-  currentSet.in = currentSet.gen;
-  for (auto value : currentSet.out) {
-    if (currentSet.not_prsv.find(value) == currentSet.not_prsv.end()) {
-      currentSet.in.insert(value);
-    }
-  }
+template <typename SetType>
+BitVector LiveVariableAnalysisPass<SetType>::Problem::boundary() {
+  // nothing is live out of the exit
+  return top();
+}
+
+template <typename SetType>
+void LiveVariableAnalysisPass<SetType>::Problem::meet(BitVector &into,
+                                                      const BitVector &from) {
+  into.unionWith(from);
+}
+
+template <typename SetType>
+bool LiveVariableAnalysisPass<SetType>::Problem::transfer(
+    const Summary &summary, const BitVector &out, BitVector &in) {
+  // in = gen | (out & ~not_prsv)
+  return in.assignUnionDifference(summary.gen, out, summary.not_prsv);
+}
+
+template <typename SetType>
+SetType LiveVariableAnalysisPass<SetType>::materialize(
+    const BitVector &bits, const std::vector<Value> &registers) {
+  SetType set;
+  bits.forEach([&](unsigned int reg) { set.insert(registers[reg]); });
+  return set;
 }
 
 template <typename SetType>
 void LiveVariableAnalysisPass<SetType>::dump() const {
   // debug output
-  for (auto table : _setsMap) {
-    auto proc = table.first;
-    for (auto pair : table.second) {
-      auto block = pair.first;
-      std::cerr << "live variable analysis for " << block.debugName << " in "
-                << proc.getFrame().name << ":\n";
-      DataFlowSets<SetType> sets = pair.second;
+  for (const auto &table : _setsMap) {
+    for (unsigned int id = 0; id < table.second.size(); id++) {
+      std::cerr << "live variable analysis for block " << id << " in "
+                << table.first << ":\n";
+      const DataFlowSets<SetType> &sets = table.second[id];
       std::cerr << "IN:\n";
       for (auto value : sets.in) {
         std::cerr << "   " << value.getFullText() << std::endl;
@@ -0,0 +1,70 @@
+#include "loopnestingpass.h"
+
+void LoopNestingPass::run(IlocProgram &prog) {
+  _dtpass.run(prog);
+
+  _depthsMap.clear();
+  for (const auto &proc : prog.getProcedures()) {
+    _depthsMap.insert({proc.getFrame().name, computeLoopDepths(proc)});
+  }
+}
+
+const std::vector<unsigned int> &
+LoopNestingPass::getLoopDepths(const IlocProcedure &proc) {
+  const std::string &name = proc.getFrame().name;
+  if (_depthsMap.find(name) == _depthsMap.end()) {
+    _depthsMap.insert({name, computeLoopDepths(proc)});
+  }
+
+  return _depthsMap.at(name);
+}
+
+std::vector<unsigned int>
+LoopNestingPass::computeLoopDepths(const IlocProcedure &proc) {
+  const IlocProcedure::BlockList &blocks = proc.orderedBlocks();
+  const DominatorTree &tree = _dtpass.getDominatorTree(proc);
+  std::vector<unsigned int> depths(blocks.size(), 0);
+
+  // marks the blocks of the loop being collected
+  std::vector<unsigned int> marks(blocks.size(), DominatorTree::none);
+
+  for (unsigned int header = 0; header < blocks.size(); header++) {
+    if (!tree.contains(header))
+      continue;
+
+    // walk backwards from the sources of every back edge into the header
+    std::vector<unsigned int> worklist;
+    bool isHeader = false;
+    marks[header] = header;
+    for (auto pred : blocks[header].before) {
+      if (!tree.contains(pred) || !tree.dominates(header, pred))
+        continue;
+
+      isHeader = true;
+      if (marks[pred] != header) {
+        marks[pred] = header;
+        worklist.push_back(pred);
+      }
+    }
+
+    if (!isHeader)
+      continue;
+
+    depths[header]++;
+    while (!worklist.empty()) {
+      unsigned int id = worklist.back();
+      worklist.pop_back();
+      depths[id]++;
+
+      for (auto pred : blocks[id].before) {
+        // unreachable blocks can't be part of a loop
+        if (tree.contains(pred) && marks[pred] != header) {
+          marks[pred] = header;
+          worklist.push_back(pred);
+        }
+      }
+    }
+  }
+
+  return depths;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "dominatortreepass.h"
+#include "ilocprocedure.h"
+#include "pass.h"
+
+// finds the natural loops of each procedure and how deeply each block is
+// nested in them. an edge into a block that dominates its source is a back
+// edge, and its loop is the header plus every block that reaches the source
+// without passing through the header. back edges into the same header form a
+// single loop.
+class LoopNestingPass : public Pass {
+public:
+  void run(IlocProgram &prog);
+  // block id -> number of loops the block is in
+  const std::vector<unsigned int> &getLoopDepths(const IlocProcedure &proc);
+
+private:
+  std::vector<unsigned int> computeLoopDepths(const IlocProcedure &proc);
+
+  DominatorTreePass _dtpass;
+  // procedure name -> depths
+  std::unordered_map<std::string, std::vector<unsigned int>> _depthsMap;
+};
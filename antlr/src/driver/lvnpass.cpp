@@ -2,41 +2,45 @@
 
 #include "lvnpass.h"
 
-IlocProgram LVNPass::applyToProgram(IlocProgram program) {
-  IlocProgram optimizedProgram = program;
+static bool isCall(const Operation &op) {
+  return op.opcode == ilocParser::CALL || op.opcode == ilocParser::ICALL ||
+         op.opcode == ilocParser::FCALL;
+}
 
+void LVNPass::run(IlocProgram &program) {
   std::cerr << "performing local value numbering\n";
 
-  optimizedProgram.clearProcedures();
-
-  for (IlocProcedure proc : program.getProcedures()) {
-    std::vector<BasicBlock> newBlocks = applyLVNtoBlocks(proc.orderedBlocks());
-    proc.clearBlocks();
-    proc.addBlocks(newBlocks);
-    optimizedProgram.addProcedure(proc);
+  for (auto &proc : program.getProceduresReference()) {
+    applyLVNtoBlocks(proc.orderedBlocksReference());
   }
-
-  return optimizedProgram;
 }
 
-std::vector<BasicBlock>
-LVNPass::applyLVNtoBlocks(std::vector<BasicBlock> blocks) {
+void LVNPass::applyLVNtoBlocks(std::vector<BasicBlock> &blocks) {
   for (auto &block : blocks) {
     // std::cerr << "\n\n";
     resetTables();
     for (auto &inst : block.instructions) {
+      // calls have side effects, so two alike are never the same expression.
+      // what they define holds something new afterwards.
+      if (isCall(inst.operation)) {
+        for (const auto &lvalue : inst.operation.lvalues) {
+          redefine(lvalue);
+        }
+        continue;
+      }
+
       // skip instructions with zero lvalue or more than 1 lvalue
-      // such as nop, output, and call
+      // such as nop and output
       if (inst.operation.lvalues.size() == 1) {
         applySubsume(inst);
         Value lvalue = inst.operation.lvalues.front();
         // build expression
         Expression expr;
         if (inst.operation.rvalues.size() > 0) {
-          expr.rValueOne = valNum(inst.operation.rvalues[0].getName());
+          expr.rValueOne = valNum(inst.operation.rvalues[0].getNameSymbol());
         }
         if (inst.operation.rvalues.size() > 1) {
-          expr.rValueTwo = valNum(inst.operation.rvalues[1].getName());
+          expr.rValueTwo = valNum(inst.operation.rvalues[1].getNameSymbol());
         }
         expr.opcode = inst.operation.opcode;
 
@@ -44,10 +48,10 @@ LVNPass::applyLVNtoBlocks(std::vector<BasicBlock> blocks) {
           // insert into expression table if not already in there
           if (expressionTable.find(expr) == expressionTable.end()) {
             // put into expression table
-            expressionTable.insert({expr, lvalue.getName()});
+            expressionTable.insert({expr, lvalue.getNameSymbol()});
 
             // handle loadI
-            uint num = valNum(inst.operation.rvalues.front().getName());
+            uint num = valNum(inst.operation.rvalues.front().getNameSymbol());
             setValNum(lvalue, num);
           } else {
             // it's already there
@@ -59,7 +63,7 @@ LVNPass::applyLVNtoBlocks(std::vector<BasicBlock> blocks) {
           if (inst.operation.opcode == ilocParser::I2I ||
               inst.operation.opcode == ilocParser::F2F) {
             // handle it
-            uint num = valNum(inst.operation.rvalues.front().getName());
+            uint num = valNum(inst.operation.rvalues.front().getNameSymbol());
             removeSubsume(lvalue);
             setValNum(lvalue, num);
             if (constantTable.find(num) != constantTable.end()) {
@@ -67,7 +71,7 @@ LVNPass::applyLVNtoBlocks(std::vector<BasicBlock> blocks) {
               inst.changeToLoadI(constantTable.at(num));
               // std::cerr << "(changed) ";
             } else {
-              subsume(lvalue, inst.operation.rvalues.front().getName());
+              subsume(lvalue, inst.operation.rvalues.front().getNameSymbol());
             }
           }
         } else {
@@ -83,7 +87,8 @@ LVNPass::applyLVNtoBlocks(std::vector<BasicBlock> blocks) {
               inst.changeToLoadI(res);
               // std::cerr << "(changed) ";
               removeSubsume(lvalue);
-              setValNum(lvalue, valNum(std::to_string(res)));
+              setValNum(lvalue,
+                        valNum(SymbolTable::intern(std::to_string(res))));
             } catch (LVNPass::ConstantPropagationError &e) {
               // just don't propagate
             }
@@ -91,9 +96,9 @@ LVNPass::applyLVNtoBlocks(std::vector<BasicBlock> blocks) {
             // check for existence
             if (expressionTable.find(expr) != expressionTable.end()) {
               // it's in there
-              std::string newLValue = expressionTable.at(expr);
+              SymbolTable::Symbol newLValue = expressionTable.at(expr);
               uint number = valNum(newLValue);
-              inst.changeToMove(newLValue);
+              inst.changeToMove(SymbolTable::text(newLValue));
               // std::cerr << "(changed) ";
               removeSubsume(lvalue);
               setValNum(lvalue, number);
@@ -108,9 +113,9 @@ LVNPass::applyLVNtoBlocks(std::vector<BasicBlock> blocks) {
                 // operation with no rvalues so once one read happens, the
                 // expression table to include READ -1, -1, which will trigger
                 // improper changeToMoves
-                expressionTable.insert({expr, lvalue.getName()});
+                expressionTable.insert({expr, lvalue.getNameSymbol()});
               }
-              setValNum(lvalue, valNum(lvalue.getName()));
+              setValNum(lvalue, valNum(lvalue.getNameSymbol()));
             }
           }
         }
@@ -119,20 +124,18 @@ LVNPass::applyLVNtoBlocks(std::vector<BasicBlock> blocks) {
       // std::cerr << inst.fullText() << "\n";
     }
   }
-
-  return blocks;
 }
 
-void LVNPass::subsume(Value l, std::string name) {
-  symbolTable.at(name).subsumes.push_back(l.getName());
-  symbolTable.at(l.getName()).subsumedBy = name;
+void LVNPass::subsume(Value l, SymbolTable::Symbol name) {
+  symbolTable.at(name).subsumes.push_back(l.getNameSymbol());
+  symbolTable.at(l.getNameSymbol()).subsumedBy = name;
 }
 
 void LVNPass::applySubsume(Instruction &inst) {
   for (auto &v : inst.operation.rvalues) {
-    if (symbolTable.find(v.getName()) != symbolTable.end()) {
-      std::string subdBy = symbolTable.at(v.getName()).subsumedBy;
-      if (subdBy != "") {
+    if (symbolTable.find(v.getNameSymbol()) != symbolTable.end()) {
+      SymbolTable::Symbol subdBy = symbolTable.at(v.getNameSymbol()).subsumedBy;
+      if (subdBy != SymbolTable::empty) {
         v.setName(subdBy);
       }
     }
@@ -140,33 +143,59 @@ void LVNPass::applySubsume(Instruction &inst) {
 }
 
 void LVNPass::removeSubsume(Value lvalue) {
-  if (symbolTable.find(lvalue.getName()) != symbolTable.end()) {
-    std::vector<std::string> subsList =
-        symbolTable.at(lvalue.getName()).subsumes;
+  if (symbolTable.find(lvalue.getNameSymbol()) != symbolTable.end()) {
+    std::vector<SymbolTable::Symbol> subsList =
+        symbolTable.at(lvalue.getNameSymbol()).subsumes;
     for (auto subs : subsList) {
-      symbolTable.at(subs).subsumedBy = "";
+      symbolTable.at(subs).subsumedBy = SymbolTable::empty;
     }
-    symbolTable.at(lvalue.getName()).subsumes.clear();
+    symbolTable.at(lvalue.getNameSymbol()).subsumes.clear();
   }
 }
 
-uint LVNPass::valNum(std::string name) {
+void LVNPass::redefine(Value lvalue) {
+  removeSubsume(lvalue);
+
+  // uses after this are of the new value, not of what it was a copy of
+  auto it = symbolTable.find(lvalue.getNameSymbol());
+  if (it != symbolTable.end() && it->second.subsumedBy != SymbolTable::empty) {
+    auto &subsumes = symbolTable.at(it->second.subsumedBy).subsumes;
+    subsumes.erase(
+        std::remove(subsumes.begin(), subsumes.end(), lvalue.getNameSymbol()),
+        subsumes.end());
+    it->second.subsumedBy = SymbolTable::empty;
+  }
+
+  // and the expressions it held are gone
+  for (auto expr = expressionTable.begin(); expr != expressionTable.end();) {
+    if (expr->second == lvalue.getNameSymbol()) {
+      expr = expressionTable.erase(expr);
+    } else {
+      expr++;
+    }
+  }
+
+  setValNum(lvalue, nextID++);
+}
+
+uint LVNPass::valNum(SymbolTable::Symbol name) {
   if (symbolTable.find(name) != symbolTable.end()) {
     return symbolTable.at(name).number;
   } else {
     // handle constants
+    const std::string &text = SymbolTable::text(name);
 
     // https://stackoverflow.com/a/37864920
     bool isConstant =
-        (name.find_first_not_of("-0123456789") == std::string::npos);
+        (text.find_first_not_of("-0123456789") == std::string::npos);
 
     if (isConstant == true) {
       // add it to the constant table
-      constantTable.insert({nextID, std::stoi(name)});
+      constantTable.insert({nextID, std::stoi(text)});
     }
 
     // we've determined it's not there, create it
-    symbolTable.insert({name, {nextID, "", {}}});
+    symbolTable.insert({name, {nextID, SymbolTable::empty, {}}});
 
     // increment nextID
     nextID++;
@@ -177,8 +206,8 @@ uint LVNPass::valNum(std::string name) {
 
 void LVNPass::setValNum(Value val, uint number) {
   // create symbol if it's not there
-  valNum(val.getName());
-  symbolTable.at(val.getName()).number = number;
+  valNum(val.getNameSymbol());
+  symbolTable.at(val.getNameSymbol()).number = number;
 }
 
 int LVNPass::calculateConstantOp(Expression e, Instruction inst) const {
@@ -292,8 +321,7 @@ void LVNPass::propagateConstants(Instruction &inst) {
     }
 
     Value &rightVal = inst.operation.rvalues[1];
-    std::string rightValText = rightVal.getName();
-    uint rightValNum = valNum(rightVal.getName());
+    uint rightValNum = valNum(rightVal.getNameSymbol());
 
     if (isConstant(rightVal)) {
       switch (inst.operation.opcode) {
@@ -358,7 +386,7 @@ void LVNPass::swapRValues(Instruction &inst) {
 }
 
 bool LVNPass::isConstant(const Value &v) {
-  uint valnum = valNum(v.getName());
+  uint valnum = valNum(v.getNameSymbol());
   return (constantTable.find(valnum) != constantTable.end());
 }
 
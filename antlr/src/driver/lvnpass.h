@@ -11,30 +11,31 @@
 
 class LVNPass : public Pass {
 public:
-  IlocProgram applyToProgram(IlocProgram program) override;
+  void run(IlocProgram &program) override;
 
 private:
-  std::vector<BasicBlock> applyLVNtoBlocks(std::vector<BasicBlock> blocks);
+  void applyLVNtoBlocks(std::vector<BasicBlock> &blocks);
   int calculateConstantOp(Expression e, Instruction i) const;
   void resetTables();
-  void subsume(Value l, std::string name);
+  void subsume(Value l, SymbolTable::Symbol name);
   void applySubsume(Instruction &inst);
   void removeSubsume(Value lvalue);
+  void redefine(Value lvalue);
   void propagateConstants(Instruction &inst);
-  uint valNum(std::string name);
+  uint valNum(SymbolTable::Symbol name);
   void setValNum(Value val, uint number);
   bool isConstant(const Value &v);
   void swapRValues(Instruction &inst);
   uint nextID = 1;
 
   std::unordered_map<uint, int> constantTable;
-  std::unordered_map<Expression, std::string> expressionTable;
+  std::unordered_map<Expression, SymbolTable::Symbol> expressionTable;
   struct SymbolTableEntry {
     uint number;
-    std::string subsumedBy;
-    std::vector<std::string> subsumes;
+    SymbolTable::Symbol subsumedBy;
+    std::vector<SymbolTable::Symbol> subsumes;
   };
-  std::unordered_map<std::string, SymbolTableEntry> symbolTable;
+  std::unordered_map<SymbolTable::Symbol, SymbolTableEntry> symbolTable;
 
   class ConstantPropagationError : public std::runtime_error {
   public:
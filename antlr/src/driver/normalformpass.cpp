@@ -1,44 +1,386 @@
+#include <algorithm>
+#include <cmath>
+#include <set>
+
 #include "normalformpass.h"
 
-IlocProgram NormalFormPass::applyToProgram(IlocProgram prog) {
-  // direct translation of phi nodes to predecessors
+#include "edgecopies.h"
+
+NormalFormPass::NormalFormPass(const TargetMachine &target)
+    : _target(target) {}
+
+void NormalFormPass::run(IlocProgram &prog) {
+  if (!prog.isSSA()) {
+    throw "can't operate on non-ssa program!";
+  }
+
+  std::cerr << "leaving ssa form\n";
+
+  _copies = 0;
+  _coalesced = 0;
+
+  _lnpass.run(prog);
+
   for (auto &proc : prog.getProceduresReference()) {
-    for (auto blockCopy : proc.orderedBlocks()) {
-      auto &block = proc.getBlockReference(blockCopy.debugName);
-      for (auto &phi : block.phinodes) {
-        for (auto pair : phi.getRValueMap()) {
-          std::string blockName = pair.first;
-          Value rvalue = pair.second;
-
-          if (!phi.isDeleted() &&
-              phi.getLValue().getName() != rvalue.getName()) {
-            auto &predBlock = proc.getBlockReference(blockName);
-            // create instruction
-            Operation op(ilocParser::I2I);
-            op.arrow = "=>";
-            op.lvalues.push_back(phi.getLValue());
-            op.rvalues.push_back(rvalue);
-            Instruction inst(op);
-
-            // remember last instruction
-            Instruction last = predBlock.instructions.back();
-
-            if (last.operation.category == Operation::Category::branch) {
-              predBlock.instructions.pop_back();
-            }
-
-            // add instruction
-            predBlock.instructions.push_back(inst);
-
-            if (last.operation.category == Operation::Category::branch) {
-              // add last instruction back
-              predBlock.instructions.push_back(last);
-            }
+    Values values = numberValues(proc);
+    buildInterference(proc, values);
+    UnionFind classes = coalesce(proc, values);
+    std::vector<std::string> names = nameClasses(values, classes);
+    leaveSSA(proc, values, names);
+  }
+
+  prog.setIsSSA(false);
+
+  std::cerr << _coalesced << " copies coalesced.\n";
+  std::cerr << _copies << " copies inserted for phis.\n";
+}
+
+NormalFormPass::Values
+NormalFormPass::numberValues(const IlocProcedure &proc) {
+  Values values;
+  auto number = [&](const Value &value, bool pinned) {
+    auto it = values.numbers.find(value);
+    if (it != values.numbers.end()) {
+      return;
+    }
+
+    values.numbers.insert({value, values.values.size()});
+    values.values.push_back(value);
+    values.pinned.push_back(pinned);
+  };
+
+  for (const auto &argValue : proc.getFrame().arguments) {
+    number(argValue, true);
+  }
+
+  // the special registers are set up by the caller
+  auto isSpecial = [&](const Value &value) {
+    return _target.getReservedRegister(value.getName()) != -1;
+  };
+  auto reference = [&](const Value &value) {
+    if (value.getType() == Value::Type::virtualReg) {
+      number(value, isSpecial(value));
+    }
+  };
+
+  for (const auto &block : proc.orderedBlocks()) {
+    for (const auto &phi : block.phinodes) {
+      if (phi.isDeleted())
+        continue;
+
+      reference(phi.getLValue());
+      for (const auto &pair : phi.getRValueMap()) {
+        reference(pair.second);
+      }
+    }
+
+    for (const auto &inst : block.instructions) {
+      if (inst.isDeleted())
+        continue;
+
+      for (const auto &lval : inst.operation.lvalues) {
+        reference(lval);
+      }
+      for (const auto &rval : inst.operation.rvalues) {
+        reference(rval);
+      }
+    }
+  }
+
+  return values;
+}
+
+void NormalFormPass::buildInterference(const IlocProcedure &proc,
+                                       Values &values) {
+  SSALivenessProblem problem(proc, values.numbers,
+                             BitVector(values.values.size()));
+  DataFlowSolver<SSALivenessProblem> solver(problem);
+  solver.solve(proc);
+
+  unsigned int size = values.values.size();
+  values.interference.assign(size, BitVector(size));
+  auto connect = [&](unsigned int a, unsigned int b) {
+    if (a != b) {
+      values.interference[a].set(b);
+      values.interference[b].set(a);
+    }
+  };
+
+  for (const auto &block : proc.orderedBlocks()) {
+    BitVector live = solver.getOut(block.id);
+    problem.addPhiOperands(block, live);
+
+    for (auto it = block.instructions.rbegin(); it != block.instructions.rend();
+         it++) {
+      const Instruction &inst = *it;
+      if (inst.isDeleted())
+        continue;
+
+      // a copy doesn't make its destination interfere with its source, the
+      // two hold the same value
+      const Operation &op = inst.operation;
+      bool isMove = op.opcode == ilocParser::I2I &&
+                    op.rvalues.front().getType() == Value::Type::virtualReg;
+
+      std::vector<unsigned int> defined;
+      for (const auto &lval : op.lvalues) {
+        if (lval.getType() != Value::Type::virtualReg)
+          continue;
+
+        unsigned int n = values.numbers.at(lval);
+        live.forEach([&](unsigned int other) {
+          if (!isMove || other != values.numbers.at(op.rvalues.front())) {
+            connect(n, other);
           }
+        });
+        defined.push_back(n);
+      }
+
+      // a call writes all of its lvalues at once
+      for (auto a : defined) {
+        for (auto b : defined) {
+          connect(a, b);
+        }
+        live.reset(a);
+      }
+
+      for (const auto &rval : op.rvalues) {
+        if (rval.getType() == Value::Type::virtualReg) {
+          live.set(values.numbers.at(rval));
         }
       }
     }
+
+    // phis are written at the top of the block all at once, by copies at the
+    // end of its predecessors. they interfere with everything live through
+    // them even when nothing uses them.
+    std::vector<unsigned int> phis;
+    for (const auto &phi : block.phinodes) {
+      if (!phi.isDeleted()) {
+        phis.push_back(values.numbers.at(phi.getLValue()));
+      }
+    }
+    for (auto a : phis) {
+      live.forEach([&](unsigned int other) { connect(a, other); });
+      for (auto b : phis) {
+        connect(a, b);
+      }
+    }
+  }
+}
+
+UnionFind NormalFormPass::coalesce(const IlocProcedure &proc,
+                                   const Values &values) {
+  unsigned int size = values.values.size();
+  UnionFind classes(size);
+  std::vector<std::vector<unsigned int>> members(size);
+  std::vector<bool> pinned = values.pinned;
+  for (unsigned int n = 0; n < size; n++) {
+    members[n].push_back(n);
+  }
+
+  auto merge = [&](unsigned int a, unsigned int b) {
+    a = classes.find(a);
+    b = classes.find(b);
+    if (a == b)
+      return;
+
+    unsigned int root = classes.unite(a, b);
+    unsigned int other = root == a ? b : a;
+    members[root].insert(members[root].end(), members[other].begin(),
+                         members[other].end());
+    members[other].clear();
+    pinned[root] = pinned[a] || pinned[b];
+  };
+
+  auto interferes = [&](unsigned int a, unsigned int b) {
+    for (auto m : members[a]) {
+      for (auto n : members[b]) {
+        if (values.interference[m].test(n)) {
+          return true;
+        }
+      }
+    }
+    return false;
+  };
+
+  // call by reference writes the arguments of a call back into their
+  // registers
+  const std::vector<unsigned int> &loopDepths = _lnpass.getLoopDepths(proc);
+  std::vector<Candidate> candidates;
+
+  for (const auto &block : proc.orderedBlocks()) {
+    float weight = std::pow(10.0f, static_cast<float>(loopDepths[block.id]));
+
+    for (const auto &inst : block.instructions) {
+      if (inst.isDeleted())
+        continue;
+
+      const Operation &op = inst.operation;
+      for (const auto &pair : op.getWrittenArguments()) {
+        merge(values.numbers.at(op.rvalues[pair.first]),
+              values.numbers.at(op.lvalues[pair.second]));
+      }
+
+      if (op.opcode == ilocParser::I2I &&
+          op.rvalues.front().getType() == Value::Type::virtualReg) {
+        candidates.push_back({values.numbers.at(op.lvalues.front()),
+                              values.numbers.at(op.rvalues.front()), weight});
+      }
+    }
+
+    for (const auto &phi : block.phinodes) {
+      if (phi.isDeleted())
+        continue;
+
+      for (const auto &pair : phi.getRValueMap()) {
+        if (!proc.takesEdge(pair.first, block.id))
+          continue;
+
+        float predWeight =
+            std::pow(10.0f, static_cast<float>(loopDepths[pair.first]));
+        candidates.push_back({values.numbers.at(phi.getLValue()),
+                              values.numbers.at(pair.second), predWeight});
+      }
+    }
+  }
+
+  // copies that run the most go first
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate &a, const Candidate &b) {
+                     return a.weight > b.weight;
+                   });
+
+  for (const auto &candidate : candidates) {
+    unsigned int a = classes.find(candidate.destination);
+    unsigned int b = classes.find(candidate.source);
+    if (a == b || pinned[a] || pinned[b] || interferes(a, b))
+      continue;
+
+    merge(a, b);
+    _coalesced++;
+  }
+
+  return classes;
+}
+
+std::vector<std::string> NormalFormPass::nameClasses(const Values &values,
+                                                     UnionFind &classes) {
+  unsigned int size = values.values.size();
+
+  _nextRegister = 0;
+  for (const auto &value : values.values) {
+    _nextRegister = std::max(
+        _nextRegister,
+        static_cast<unsigned int>(std::stoi(value.getName().substr(3))) + 1);
+  }
+
+  // pinned classes keep their registers, the others keep the register of
+  // their first value unless another class already has it
+  std::vector<std::string> rootNames(size);
+  std::set<std::string> taken;
+  for (unsigned int n = 0; n < size; n++) {
+    unsigned int root = classes.find(n);
+    if (values.pinned[n] && rootNames[root] == "") {
+      rootNames[root] = values.values[n].getName();
+      taken.insert(rootNames[root]);
+    }
+  }
+  for (unsigned int n = 0; n < size; n++) {
+    unsigned int root = classes.find(n);
+    if (rootNames[root] != "")
+      continue;
+
+    std::string name = values.values[n].getName();
+    if (taken.find(name) != taken.end()) {
+      name = "%vr" + std::to_string(_nextRegister++);
+    }
+    rootNames[root] = name;
+    taken.insert(name);
+  }
+
+  std::vector<std::string> names(size);
+  for (unsigned int n = 0; n < size; n++) {
+    names[n] = rootNames[classes.find(n)];
+  }
+  return names;
+}
+
+void NormalFormPass::leaveSSA(IlocProcedure &proc, const Values &values,
+                              const std::vector<std::string> &names) {
+  EdgeCopies edges;
+  std::string scratch;
+  auto findTemp = [&](const std::string &) {
+    if (scratch == "") {
+      scratch = "%vr" + std::to_string(_nextRegister++);
+    }
+    return scratch;
+  };
+
+  for (const auto &block : proc.orderedBlocks()) {
+    for (auto predId : block.before) {
+      if (!proc.takesEdge(predId, block.id))
+        continue;
+
+      EdgeCopies::ParallelCopies pending;
+      for (const auto &phi : block.phinodes) {
+        if (phi.isDeleted())
+          continue;
+
+        auto it = phi.getRValueMap().find(predId);
+        if (it == phi.getRValueMap().end())
+          continue;
+
+        const std::string &to = names[values.numbers.at(phi.getLValue())];
+        const std::string &from = names[values.numbers.at(it->second)];
+        if (from != to) {
+          pending[to] = from;
+        }
+      }
+
+      _copies += edges.add(proc, predId, block.id, pending, findTemp);
+    }
+  }
+
+  // every value takes the register of its class
+  auto rename = [&](Value &value) {
+    if (value.getType() != Value::Type::virtualReg)
+      return;
+
+    const std::string &name = names[values.numbers.at(value)];
+    value.setSubscript(value.getFullText());
+    value.setName(name);
+  };
+
+  for (auto &arg : proc.getFrameReference().arguments) {
+    rename(arg);
+  }
+
+  for (auto &block : proc.orderedBlocksReference()) {
+    for (auto &inst : block.instructions) {
+      if (inst.isDeleted())
+        continue;
+
+      for (auto &lval : inst.operation.lvalues) {
+        rename(lval);
+      }
+      for (auto &rval : inst.operation.rvalues) {
+        rename(rval);
+      }
+
+      // copies inside a class do nothing
+      if (inst.operation.opcode == ilocParser::I2I && inst.label == "" &&
+          inst.operation.rvalues.front().getName() ==
+              inst.operation.lvalues.front().getName()) {
+        inst.markAsDeleted();
+      }
+    }
+
+    // the copies take the place of the phis
+    for (auto &phi : block.phinodes) {
+      phi.markAsDeleted();
+    }
   }
 
-  return prog;
+  edges.insert(proc);
 }
@@ -1,10 +1,65 @@
 #pragma once
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bitvector.h"
+#include "loopnestingpass.h"
 #include "pass.h"
+#include "ssalivenessproblem.h"
+#include "targetmachine.h"
+#include "unionfind.h"
 
+// takes the program out of ssa, for code that isn't register allocated. the
+// values connected by a phi or a copy are coalesced into one congruence class
+// whenever no two members of the classes interfere, after boissinot et al.,
+// the most frequently executed copies first. every class becomes one
+// register, so the copies inside a class go away. the phi operands left in
+// another class are copied on the edges into the phi's block. the copies of
+// an edge happen in parallel, so they're ordered to read every register
+// before it is written, and a cycle of them is broken with a scratch
+// register. an edge out of a conditional branch gets a block of its own to
+// hold them.
+//
+// arguments and the special registers keep their registers, and values
+// passed to a call share a register with the value it writes back.
 class NormalFormPass : public Pass {
 public:
-  IlocProgram applyToProgram(IlocProgram prog);
+  NormalFormPass(const TargetMachine &target);
+  void run(IlocProgram &prog);
 
 private:
+  // the ssa values of a procedure, numbered densely
+  struct Values {
+    std::vector<Value> values;
+    std::unordered_map<Value, unsigned int> numbers;
+    // values that have to keep their register: arguments and the special
+    // registers
+    std::vector<bool> pinned;
+    std::vector<BitVector> interference;
+  };
+
+  // a copy that goes away if its two values share a class
+  struct Candidate {
+    unsigned int destination;
+    unsigned int source;
+    float weight;
+  };
+
+  Values numberValues(const IlocProcedure &proc);
+  void buildInterference(const IlocProcedure &proc, Values &values);
+  UnionFind coalesce(const IlocProcedure &proc, const Values &values);
+  std::vector<std::string> nameClasses(const Values &values,
+                                       UnionFind &classes);
+  // names holds the register of each value
+  void leaveSSA(IlocProcedure &proc, const Values &values,
+                const std::vector<std::string> &names);
+
+  const TargetMachine &_target;
+  LoopNestingPass _lnpass;
+  // first register number the procedure doesn't use
+  unsigned int _nextRegister;
+  unsigned int _copies;
+  unsigned int _coalesced;
 };
@@ -10,23 +10,21 @@
 class OptRenamePass : public Pass {
 public:
   OptRenamePass();
-  IlocProgram applyToProgram(IlocProgram prog);
+  void run(IlocProgram &prog);
 
 private:
   DominatorTreePass DTreePass;
   DominatorTreePass PDTreePass;
-  std::set<BasicBlock> iteratedDominanceFrontier(Value variable,
-                                                 IlocProcedure proc);
 
-  void placePhiNodes(IlocProgram &prog, IlocProcedure &proc);
+  void placePhiNodes(IlocProcedure &proc);
 
   void optRenameInit(IlocProcedure &proc);
   void optRename(BasicBlock &block, IlocProcedure &proc);
   Value pushNewName(Value val);
   Value popNameStack(Value val);
-  std::string newSubscript(Value val);
-  std::unordered_map<std::string, std::stack<Value>> nameStackMap;
-  std::unordered_map<std::string, unsigned int> nextNameMap;
+  SymbolTable::Symbol newSubscript(Value val);
+  std::unordered_map<SymbolTable::Symbol, std::stack<Value>> nameStackMap;
+  std::unordered_map<SymbolTable::Symbol, unsigned int> nextNameMap;
 
   void startBlock();
   void endBlock();
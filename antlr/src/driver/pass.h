@@ -4,7 +4,7 @@
 
 class Pass {
 public:
-  virtual IlocProgram applyToProgram(IlocProgram program) = 0;
+  virtual void run(IlocProgram &program) = 0;
 
 private:
 };
@@ -7,20 +7,37 @@ Value PhiNode::getLValue() const { return _lValue; }
 
 void PhiNode::setLValue(Value lvalue) { _lValue = lvalue; }
 
-Value PhiNode::getRValue(BasicBlock pred) const {
-  return _rValueMap.at(pred.debugName);
+Value PhiNode::getRValue(const BasicBlock &pred) const {
+  return _rValueMap.at(pred.id);
 }
 
-void PhiNode::replaceRValue(BasicBlock pred, Value value) {
-  _rValueMap.at(pred.debugName) = value;
+void PhiNode::replaceRValue(const BasicBlock &pred, Value value) {
+  _rValueMap.at(pred.id) = value;
 }
 
-std::unordered_map<std::string, Value> PhiNode::getRValueMap() const {
+const std::unordered_map<unsigned int, Value> &PhiNode::getRValueMap() const {
   return _rValueMap;
 }
 
-void PhiNode::addRValue(BasicBlock block, Value value) {
-  _rValueMap.insert({block.debugName, value});
+void PhiNode::addRValue(const BasicBlock &block, Value value) {
+  _rValueMap.insert({block.id, value});
+}
+
+void PhiNode::replacePredecessor(unsigned int from, unsigned int to) {
+  auto it = _rValueMap.find(from);
+  if (it != _rValueMap.end()) {
+    Value value = it->second;
+    _rValueMap.erase(it);
+    _rValueMap.insert({to, value});
+  }
+}
+
+void PhiNode::renumberPredecessors(const std::vector<unsigned int> &newIds) {
+  std::unordered_map<unsigned int, Value> renumbered;
+  for (const auto &pair : _rValueMap) {
+    renumbered.insert({newIds.at(pair.first), pair.second});
+  }
+  _rValueMap = renumbered;
 }
 
 bool operator==(const PhiNode &a, const PhiNode &b) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <unordered_map>
+#include <vector>
 
 #include "value.h"
 
@@ -11,17 +12,22 @@ public:
   PhiNode(Value value);
   Value getLValue() const;
   void setLValue(Value lvalue);
-  Value getRValue(BasicBlock pred) const;
-  void replaceRValue(BasicBlock pred, Value value);
-  std::unordered_map<std::string, Value> getRValueMap() const;
-  void addRValue(BasicBlock block, Value value);
+  Value getRValue(const BasicBlock &pred) const;
+  void replaceRValue(const BasicBlock &pred, Value value);
+  const std::unordered_map<unsigned int, Value> &getRValueMap() const;
+  void addRValue(const BasicBlock &block, Value value);
+  // the value flowing in from one block now flows in from another
+  void replacePredecessor(unsigned int from, unsigned int to);
+  // old block id -> new block id
+  void renumberPredecessors(const std::vector<unsigned int> &newIds);
   bool isDeleted() const;
   void markAsDeleted();
 
 private:
   bool _deleted;
   Value _lValue;
-  std::unordered_map<std::string, Value> _rValueMap;
+  // predecessor block id -> value flowing in along that edge
+  std::unordered_map<unsigned int, Value> _rValueMap;
 };
 
 namespace std {
@@ -1,148 +1,223 @@
+#include <memory>
+
 #include "registerallocationpass.h"
 
+#include "graphcolorer.h"
 #include "interferencegraph.h"
 #include "liverangespass.h"
 #include "livevariableanalysispass.h"
+#include "loopnestingpass.h"
+#include "spillcode.h"
+#include "spillcodecleaner.h"
+#include "spillslotallocator.h"
 #include "ssapass.h"
 
-IlocProgram RegisterAllocationPass::applyToProgram(IlocProgram prog) {
+RegisterAllocationPass::RegisterAllocationPass(const TargetMachine &target,
+                                               SpillMode mode)
+    : _target(target), _mode(mode) {}
+
+void RegisterAllocationPass::run(IlocProgram &prog) {
   bool dirtyProg = true;
   unsigned int iterations = 0;
   std::unordered_map<std::string, std::set<LiveRange>> spilledSetMap;
 
-  int registers = 8;
-
-  std::cerr << "performing global register allocation with " << registers
-            << " registers\n";
+  std::cerr << "performing global register allocation with "
+            << _target.describe();
+  if (_mode == SpillMode::split) {
+    std::cerr << " and live range splitting";
+  }
+  std::cerr << "\n";
 
   // initialize
-  for (auto proc : prog.getProcedures()) {
+  for (const auto &proc : prog.getProcedures()) {
+    _target.checkArguments(proc);
     _dirtyMap[proc.getFrame().name] = true;
     spilledSetMap.insert({proc.getFrame().name, {}});
     _graphMap.insert({proc.getFrame().name, InterferenceGraph()});
+    _coloredMap.insert({proc.getFrame().name, InterferenceGraph()});
   }
 
   _offsetMap.clear();
-
-  LiveRangesPass lrpass;
-  prog = lrpass.applyToProgram(prog);
+  _pieceMap.clear();
+  _rematMap.clear();
+  _splitValues = 0;
+  _removedMoves = 0;
+
+  LiveRangesPass lrpass(_target);
+  lrpass.run(prog);
+
+  // allocation doesn't change the cfg, loops only have to be found once
+  LoopNestingPass lnpass;
+  lnpass.run(prog);
+
+  // liveness and the graphs are kept from one round to the next. spilling
+  // everywhere doesn't rename anything, so only the spilled ranges and the
+  // frame pointer their spill code goes through have to be brought up to
+  // date. splitting makes new ranges, so it starts over on each procedure it
+  // changed.
+  LiveVariableAnalysisPass<HardValueSet> lvapass;
+  lvapass.run(prog);
 
   while (dirtyProg == true) {
     dirtyProg = false;
     iterations++;
 
-    LiveVariableAnalysisPass<HardValueSet> lvapass;
-    prog = lvapass.applyToProgram(prog);
-    // lvapass.dump();
-
     for (auto &proc : prog.getProceduresReference()) {
-      if (_dirtyMap.at(proc.getFrame().name) == true) {
-        std::cerr << "doing a graph coloring pass on " << proc.getFrame().name
-                  << "\n";
+      const std::string &name = proc.getFrame().name;
+      if (_dirtyMap.at(name) == true) {
+        std::cerr << "doing a graph coloring pass on " << name << "\n";
 
-        InterferenceGraph &igraph = _graphMap.at(proc.getFrame().name);
+        InterferenceGraph &pristine = _graphMap.at(name);
 
         // create interference graph
-        igraph.createFromLiveRanges(lrpass, proc, lvapass,
-                                    spilledSetMap.at(proc.getFrame().name));
+        if (iterations == 1 || _mode == SpillMode::split) {
+          pristine.createFromLiveRanges(lrpass, proc, lvapass,
+                                        lnpass.getLoopDepths(proc),
+                                        spilledSetMap.at(name), _target);
+        }
 
-        // process graph
-        colorGraph(igraph, registers);
+        // process graph. coloring takes the graph apart, so a copy is
+        // colored and the original is kept for the next round.
+        _coloredMap[name] = pristine;
+        InterferenceGraph &igraph = _coloredMap.at(name);
+        colorGraph(igraph);
 
         // debug output
-        // std::cerr << "graph for " << proc.getFrame().name << ":\n";
+        // std::cerr << "graph for " << name << ":\n";
         // igraph.dump();
 
         // spill
-        bool dirtyProc = spillRegisters(proc, igraph, lrpass,
-                                        spilledSetMap.at(proc.getFrame().name));
+        bool dirtyProc = spillRegisters(proc, igraph, lrpass, lvapass,
+                                        spilledSetMap.at(name));
 
-        _dirtyMap.at(proc.getFrame().name) = dirtyProc;
+        _dirtyMap.at(name) = dirtyProc;
 
         if (dirtyProc == true) {
           dirtyProg = true;
+
+          if (_mode == SpillMode::split) {
+            // splitting made new values, which need live ranges of their own
+            lrpass.update(proc);
+            lvapass.invalidate(proc);
+          } else {
+            updateSpilled(proc, pristine, igraph, lrpass, lvapass,
+                          lnpass.getLoopDepths(proc), spilledSetMap.at(name));
+          }
         }
       }
     }
   }
 
-  // convert values to mapped colors
+  // spilled ranges that are never live at the same time can share a slot.
+  // once values are in registers, spill code moving a value to where it
+  // already is can go.
+  unsigned int spillSlots = 0;
+  unsigned int packedSlots = 0;
+  unsigned int removedLoads = 0;
+  unsigned int removedStores = 0;
   for (auto &proc : prog.getProceduresReference()) {
-    remapNames(proc, _graphMap.at(proc.getFrame().name),
+    std::set<unsigned int> offsets;
+    for (const auto &pair : _offsetMap[proc.getFrame().name]) {
+      offsets.insert(pair.second);
+    }
+
+    SpillSlotAllocator slotAllocator(proc, offsets);
+    slotAllocator.allocate();
+    spillSlots += offsets.size();
+    packedSlots += slotAllocator.getSlotCount();
+
+    // convert values to mapped colors
+    remapNames(proc, _coloredMap.at(proc.getFrame().name),
                lrpass.getLiveRanges(proc));
+
+    SpillCodeCleaner cleaner(proc, offsets);
+    cleaner.clean();
+    removedLoads += cleaner.getRemovedLoads();
+    removedStores += cleaner.getRemovedStores();
   }
 
-  std::cerr << iterations << " register allocation iterations.\n";
+  unsigned int rematerialized = 0;
+  for (const auto &pair : _rematMap) {
+    rematerialized += pair.second.size();
+  }
 
-  return prog;
+  std::cerr << iterations << " register allocation iterations.\n";
+  std::cerr << rematerialized << " live ranges rematerialized.\n";
+  std::cerr << spillSlots << " spill slots packed into " << packedSlots
+            << ".\n";
+  std::cerr << _removedMoves << " moves removed by coalescing.\n";
+  std::cerr << removedLoads << " spill loads and " << removedStores
+            << " spill stores removed.\n";
 }
 
-void RegisterAllocationPass::colorGraph(InterferenceGraph &igraph,
-                                        unsigned int k) {
-  std::stack<InterferenceGraphNode> stack;
-
-  // fill up stack
-  while (igraph.empty() == false) {
-    InterferenceGraphNode cheapestNode;
+void RegisterAllocationPass::colorGraph(InterferenceGraph &igraph) {
+  GraphColorer colorer(igraph, _target);
+  colorer.color();
+}
 
-    if (igraph.minDegree() < k - 4) {
-      cheapestNode = igraph.getAnyNodeWithDegree(igraph.minDegree());
-    } else {
-      cheapestNode = igraph.getLowestSpillcostNode();
+void RegisterAllocationPass::updateSpilled(
+    const IlocProcedure &proc, InterferenceGraph &pristine,
+    const InterferenceGraph &colored, LiveRangesPass &lrpass,
+    LiveVariableAnalysisPass<HardValueSet> &lvapass,
+    const std::vector<unsigned int> &loopDepths,
+    const std::set<LiveRange> &spilledSet) {
+  const LiveRanges &ranges = lrpass.getLiveRanges(proc);
+
+  // every range that didn't get a color was spilled
+  std::vector<unsigned int> ids;
+  HardValueSet registers;
+  auto touch = [&](const LiveRange &range) {
+    ids.push_back(range.id);
+    registers.insert(range.registers.begin(), range.registers.end());
+  };
+
+  for (const auto &range : ranges.getRanges()) {
+    if (colored.getNode(range.id).color == InterferenceGraphNode::uncolored) {
+      touch(range);
     }
-
-    igraph.removeNode(cheapestNode);
-    stack.push(cheapestNode);
   }
+  touch(ranges.getRangeWithName("%vr0_0"));
 
-  // try to color
-  while (stack.empty() == false) {
-    InterferenceGraphNode node = stack.top();
-    stack.pop();
-    igraph.addNode(node);
-    igraph.colorNode(node, k);
-  }
+  lvapass.update(proc, registers);
+  pristine.updateNodes(ids, lrpass, proc, lvapass, loopDepths, spilledSet);
 }
 
-bool RegisterAllocationPass::spillRegisters(IlocProcedure &proc,
-                                            InterferenceGraph &igraph,
-                                            LiveRangesPass lrpass,
-                                            std::set<LiveRange> &spilledSet) {
+bool RegisterAllocationPass::spillRegisters(
+    IlocProcedure &proc, InterferenceGraph &igraph, LiveRangesPass &lrpass,
+    LiveVariableAnalysisPass<HardValueSet> &lvapass,
+    std::set<LiveRange> &spilledSet) {
 
-  std::set<LiveRange> rangesSet = lrpass.getLiveRanges(proc);
+  const LiveRanges &ranges = lrpass.getLiveRanges(proc);
   bool spilled = false;
 
-  // spill function arguments
-  BasicBlock &entryBlock = proc.getBlockReference("entry");
+  // calls can't write back arguments their callees return over, so those
+  // ranges are spilled whatever color they got
+  for (auto id : overwrittenRanges(proc, ranges, _target)) {
+    igraph.getNodeReference(id).color = InterferenceGraphNode::uncolored;
+  }
+  std::unordered_set<unsigned int> uncolored;
+  for (const auto &range : ranges.getRanges()) {
+    if (igraph.getNode(range.id).color == InterferenceGraphNode::uncolored) {
+      uncolored.insert(range.id);
+    }
+  }
+  dropOverwrittenArguments(proc, ranges, uncolored, _target);
 
+  // split before handling arguments, so the stores and loads added for them
+  // below keep the argument's own name
+  if (_mode == SpillMode::split) {
+    spilled = splitRanges(proc, igraph, lrpass, lvapass, spilledSet);
+  }
+
+  // spill function arguments
   for (auto argValue : proc.getFrame().arguments) {
     // lookup range value is in
-    LiveRange argRange = lrpass.getRangeWithValue(argValue, rangesSet);
-    InterferenceGraphNode node = igraph.getNode(argRange.name);
-
-    if (node.color == InterferenceGraphColor::uncolored) {
-      // spill here
-      // find instruction in question in the copied vector
-      auto instCopyPos = entryBlock.instructions.begin();
-
-      if (instCopyPos == entryBlock.instructions.end()) {
-        throw "didn't find the instruction...";
-      }
-
-      // create store instruction
-      createStoreAIInst(argValue, argRange, proc, entryBlock.instructions,
-                        instCopyPos);
+    const LiveRange &argRange = ranges.getRangeWithValue(argValue);
+    const InterferenceGraphNode &node = igraph.getNode(argRange.id);
 
-      // if we spill arguments, since they're passed by reference, we need to
-      // re-load them before returning
-      BasicBlock exitBlock = proc.getBlock(proc.getExitBlockName());
-
-      for (auto predBlockName : exitBlock.before) {
-        createLoadAIInst(
-            argValue, argRange, proc,
-            proc.getBlockReference(predBlockName).instructions,
-            --proc.getBlockReference(predBlockName).instructions.end());
-      }
+    if (node.color == InterferenceGraphNode::uncolored) {
+      spillArgument(proc, argValue, getSpillOffset(proc, argRange.name),
+                    _target);
 
       // remember that we spilled
       spilledSet.insert(argRange);
@@ -152,9 +227,11 @@ bool RegisterAllocationPass::spillRegisters(IlocProcedure &proc,
     }
   }
 
-  for (auto blockCopy : proc.orderedBlocks()) {
-    BasicBlock &block = proc.getBlockReference(blockCopy.debugName);
+  if (_mode == SpillMode::split) {
+    return spilled;
+  }
 
+  for (auto &block : proc.orderedBlocksReference()) {
     // make a copy of the instructions so we can safely edit it while iterating
     std::vector<Instruction> newInstructions = block.instructions;
 
@@ -162,19 +239,21 @@ bool RegisterAllocationPass::spillRegisters(IlocProcedure &proc,
       if (inst.isDeleted() == true)
         continue;
 
-      // don't store immediately after a load
-      if (inst.operation.opcode == ilocParser::LOADAI)
-        continue;
-
       // spill definitions - store after def
       if (inst.operation.lvalues.size() > 0) {
         Value lval = inst.operation.lvalues.front();
         if (lval.getType() == Value::Type::virtualReg) {
           // lookup range lvalue is in
-          LiveRange lvalRange = lrpass.getRangeWithValue(lval, rangesSet);
-          InterferenceGraphNode node = igraph.getNode(lvalRange.name);
+          const LiveRange &lvalRange = ranges.getRangeWithValue(lval);
+          const InterferenceGraphNode &node = igraph.getNode(lvalRange.id);
 
-          if (node.color == InterferenceGraphColor::uncolored) {
+          // don't store immediately after a load from the range's own slot
+          if (inst.operation.opcode == ilocParser::LOADAI &&
+              isSpillSlot(proc, inst.operation.rvalues[0],
+                          inst.operation.rvalues[1], lvalRange.name))
+            continue;
+
+          if (node.color == InterferenceGraphNode::uncolored) {
             // spill here
             // find instruction in question in the copied vector
             auto instCopyPos =
@@ -184,12 +263,23 @@ bool RegisterAllocationPass::spillRegisters(IlocProcedure &proc,
               throw "didn't find the instruction...";
             }
 
-            // we need to insert after the instruction
-            instCopyPos++;
-
-            // create instruction
-            createStoreAIInst(lval, lvalRange, proc, newInstructions,
-                              instCopyPos);
+            if (lvalRange.remat) {
+              // it is recomputed before each use instead, the definition
+              // isn't needed. a label has to stay where it is.
+              if (instCopyPos->label == "") {
+                instCopyPos->markAsDeleted();
+              } else {
+                instCopyPos->operation = Operation(ilocParser::NOP);
+              }
+              _rematMap[proc.getFrame().name].insert(lvalRange.name);
+            } else {
+              // we need to insert after the instruction
+              instCopyPos++;
+
+              // create instruction
+              createStoreAIInst(lval, getSpillOffset(proc, lvalRange.name),
+                                newInstructions, instCopyPos);
+            }
 
             // remember that we spilled
             spilledSet.insert(lvalRange);
@@ -206,9 +296,7 @@ bool RegisterAllocationPass::spillRegisters(IlocProcedure &proc,
   }
 
   // load before use
-  for (auto blockCopy : proc.orderedBlocks()) {
-    BasicBlock &block = proc.getBlockReference(blockCopy.debugName);
-
+  for (auto &block : proc.orderedBlocksReference()) {
     // make a copy of the instructions so we can safely edit it while
     // iterating
     std::vector<Instruction> newInstructions = block.instructions;
@@ -217,18 +305,22 @@ bool RegisterAllocationPass::spillRegisters(IlocProcedure &proc,
       if (inst.isDeleted() == true)
         continue;
 
-      // don't load immediately before a store
-      if (inst.operation.opcode == ilocParser::STOREAI)
-        continue;
-
       // spill uses - load before use
       for (auto rval : inst.operation.rvalues) {
         if (rval.getType() == Value::Type::virtualReg) {
           // lookup range rval is in
-          LiveRange rvalRange = lrpass.getRangeWithValue(rval, rangesSet);
-          InterferenceGraphNode node = igraph.getNode(rvalRange.name);
-
-          if (node.color == InterferenceGraphColor::uncolored) {
+          const LiveRange &rvalRange = ranges.getRangeWithValue(rval);
+          const InterferenceGraphNode &node = igraph.getNode(rvalRange.id);
+
+          // don't load immediately before a store to the range's own slot.
+          // rematerialized ranges have no slot, their definition is gone.
+          if (inst.operation.opcode == ilocParser::STOREAI &&
+              !rvalRange.remat &&
+              isSpillSlot(proc, inst.operation.rvalues[1],
+                          inst.operation.rvalues[2], rvalRange.name))
+            continue;
+
+          if (node.color == InterferenceGraphNode::uncolored) {
             // spill here
             // find instruction in question in the copied vector
             auto instCopyPos =
@@ -239,8 +331,10 @@ bool RegisterAllocationPass::spillRegisters(IlocProcedure &proc,
             }
 
             // create instruction
-            createLoadAIInst(rval, rvalRange, proc, newInstructions,
-                             instCopyPos);
+            unsigned int offset =
+                rvalRange.remat ? 0 : getSpillOffset(proc, rvalRange.name);
+            createReload(rvalRange, rval, offset, newInstructions,
+                         instCopyPos);
           }
         }
       }
@@ -253,80 +347,311 @@ bool RegisterAllocationPass::spillRegisters(IlocProcedure &proc,
   return spilled;
 }
 
-void RegisterAllocationPass::createStoreAIInst(
-    Value value, LiveRange lvalRange, IlocProcedure &proc,
-    std::vector<Instruction> &list, std::vector<Instruction>::iterator pos) {
+bool RegisterAllocationPass::splitRanges(
+    IlocProcedure &proc, InterferenceGraph &igraph, LiveRangesPass &lrpass,
+    LiveVariableAnalysisPass<HardValueSet> &lvapass,
+    std::set<LiveRange> &spilledSet) {
+  const LiveRanges &ranges = lrpass.getLiveRanges(proc);
+  const std::unordered_set<std::string> &pieces =
+      _pieceMap[proc.getFrame().name];
+  bool spilled = false;
 
-  // see if we already have an offset for the value
-  std::unordered_map<LiveRange, unsigned int> &offsetMap =
-      _offsetMap[proc.getFrame().name];
+  std::unordered_set<unsigned int> argumentRanges;
+  for (const auto &argValue : proc.getFrame().arguments) {
+    argumentRanges.insert(ranges.getRangeWithValue(argValue).id);
+  }
 
-  unsigned int offset;
-  if (offsetMap.find(lvalRange) == offsetMap.end()) {
-    // not found
-    offset = std::stoi(proc.getFrame().number) + 4;
-    offsetMap.insert({lvalRange, offset});
+  // a piece that was split completely and still has no color is in the way
+  // of ranges that haven't been, so those are split instead
+  std::set<unsigned int> splits;
+  for (const auto &range : ranges.getRanges()) {
+    if (igraph.getNode(range.id).color != InterferenceGraphNode::uncolored)
+      continue;
 
-    // update frame instruction
-    proc.getFrameReference().number = std::to_string(offset);
-  } else {
-    // found
-    offset = offsetMap.at(lvalRange);
+    if (spilledSet.find(range) == spilledSet.end()) {
+      splits.insert(range.id);
+      continue;
+    }
+
+    bool blocked = false;
+    for (auto neighbor : igraph.getNeighbors(range.id)) {
+      if (!igraph.isPrecolored(neighbor) &&
+          spilledSet.find(ranges.getRange(neighbor)) == spilledSet.end()) {
+        splits.insert(neighbor);
+        blocked = true;
+      }
+    }
+    if (!blocked) {
+      throw "couldn't color " + range.name +
+          ", its instruction references more values than there are "
+          "registers";
+    }
   }
 
-  // create the storeai instruction
-  Operation op(ilocParser::STOREAI);
-  Value rval = value;
-  Value lval =
-      Value("%vr0", Value::Type::virtualReg, Value::Behavior::expression);
-  lval.setSubscript("0");
-  Value offsetValue = Value("-" + std::to_string(offset), Value::Type::number,
-                            Value::Behavior::expression);
-
-  op.rvalues.push_back(rval);
-  op.rvalues.push_back(lval);
-  op.rvalues.push_back(offsetValue);
-  op.arrow = "=>";
-
-  // insert it
-  list.insert(pos, Instruction(op));
+  for (auto id : splits) {
+    const LiveRange &range = ranges.getRange(id);
+    igraph.getNodeReference(id).color = InterferenceGraphNode::uncolored;
+
+    // arguments have to be split around their references right away, they
+    // are live everywhere until they're spilled
+    if (pieces.find(range.name) != pieces.end() ||
+        argumentRanges.find(range.id) != argumentRanges.end()) {
+      splitAtReferences(proc, range, spilledSet);
+    } else {
+      splitAtBlocks(proc, range, lvapass);
+    }
+
+    spilled = true;
+  }
+
+  return spilled;
 }
 
-void RegisterAllocationPass::createLoadAIInst(
-    Value value, LiveRange valueRange, IlocProcedure &proc,
-    std::vector<Instruction> &list, std::vector<Instruction>::iterator pos) {
+void RegisterAllocationPass::splitAtBlocks(
+    IlocProcedure &proc, const LiveRange &range,
+    LiveVariableAnalysisPass<HardValueSet> &lvapass) {
+  // rematerialized ranges never touch memory
+  unsigned int offset = range.remat ? 0 : getSpillOffset(proc, range.name);
+  auto inRange = [&](const Value &value) {
+    return value.getType() == Value::Type::virtualReg &&
+           range.registers.find(value) != range.registers.end();
+  };
+
+  for (auto &block : proc.orderedBlocksReference()) {
+    // within a block the range gets a single new name. it is loaded before a
+    // use that may see a value from another block, and stored after the last
+    // definition if another block may see it.
+    std::vector<Instruction> newInstructions;
+    std::unique_ptr<Value> piece;
+    bool inRegister = false;
+    unsigned int lastDefinition = 0;
 
-  // get offset
-  unsigned int offset = _offsetMap.at(proc.getFrame().name).at(valueRange);
-
-  // create the loadai instruction
-  Operation op(ilocParser::LOADAI);
-  Value lval = value;
-  Value rval =
-      Value("%vr0", Value::Type::virtualReg, Value::Behavior::expression);
-  rval.setSubscript("0");
-  Value offsetValue = Value("-" + std::to_string(offset), Value::Type::number,
-                            Value::Behavior::expression);
-
-  op.rvalues.push_back(rval);
-  op.rvalues.push_back(offsetValue);
-  op.lvalues.push_back(lval);
-  op.arrow = "=>";
-
-  // insert it
-  list.insert(pos, Instruction(op));
+    for (auto inst : block.instructions) {
+      bool uses = false;
+      bool defines = false;
+
+      if (!inst.isDeleted()) {
+        for (auto &rval : inst.operation.rvalues) {
+          if (inRange(rval)) {
+            if (!piece)
+              piece.reset(new Value(createSplitValue(rval)));
+            rval = *piece;
+            uses = true;
+          }
+        }
+        for (auto &lval : inst.operation.lvalues) {
+          if (inRange(lval)) {
+            if (!piece)
+              piece.reset(new Value(createSplitValue(lval)));
+            lval = *piece;
+            defines = true;
+          }
+        }
+      }
+
+      newInstructions.push_back(inst);
+      if (uses && !inRegister) {
+        createReload(range, *piece, offset, newInstructions,
+                     --newInstructions.end());
+      }
+      if (uses || defines) {
+        inRegister = true;
+      }
+      if (defines) {
+        lastDefinition = newInstructions.size();
+      }
+
+      // a call overwrites the register of an argument it doesn't write back,
+      // so the rest of the block finds the piece in memory
+      bool call = inst.operation.opcode == ilocParser::CALL ||
+                  inst.operation.opcode == ilocParser::ICALL ||
+                  inst.operation.opcode == ilocParser::FCALL;
+      if (call && uses && !defines) {
+        if (lastDefinition > 0 && !range.remat) {
+          createStoreAIInst(*piece, offset, newInstructions,
+                            newInstructions.begin() + lastDefinition);
+          lastDefinition = 0;
+        }
+        inRegister = false;
+      }
+    }
+
+    if (!piece)
+      continue;
+
+    bool liveOut = false;
+    for (const auto &value : lvapass.getBlockSets(proc, block).out) {
+      if (inRange(value)) {
+        liveOut = true;
+        break;
+      }
+    }
+
+    if (lastDefinition > 0 && liveOut && !range.remat) {
+      createStoreAIInst(*piece, offset, newInstructions,
+                        newInstructions.begin() + lastDefinition);
+    }
+
+    block.instructions = newInstructions;
+    if (range.remat) {
+      _rematMap[proc.getFrame().name].insert(piece->getFullText());
+    } else {
+      _offsetMap[proc.getFrame().name][piece->getFullText()] = offset;
+    }
+    _pieceMap[proc.getFrame().name].insert(piece->getFullText());
+  }
 }
 
-void RegisterAllocationPass::remapNames(IlocProcedure &proc,
-                                        InterferenceGraph graph,
-                                        std::set<LiveRange> liveRanges) {
-  LiveRangesPass utilLRPass;
+void RegisterAllocationPass::splitAtReferences(
+    IlocProcedure &proc, const LiveRange &range,
+    std::set<LiveRange> &spilledSet) {
+  unsigned int offset = range.remat ? 0 : getSpillOffset(proc, range.name);
+  auto inRange = [&](const Value &value) {
+    return value.getType() == Value::Type::virtualReg &&
+           range.registers.find(value) != range.registers.end();
+  };
+
+  // the loads and stores that connected a block's piece to memory would only
+  // move the value between memory and a register and back
+  std::string offsetText = "-" + std::to_string(offset);
+  auto connectsPiece = [&](const Instruction &inst) {
+    const std::vector<Value> &rvals = inst.operation.rvalues;
+    if (range.remat) {
+      // its definitions are redone before each use
+      return inst.operation.lvalues.size() > 0 &&
+             inRange(inst.operation.lvalues.front());
+    } else if (inst.operation.opcode == ilocParser::LOADAI) {
+      return rvals[0].getName() == "%vr0" && rvals[1].getName() == offsetText &&
+             inRange(inst.operation.lvalues.front());
+    } else if (inst.operation.opcode == ilocParser::STOREAI) {
+      return inRange(rvals[0]) && rvals[1].getName() == "%vr0" &&
+             rvals[2].getName() == offsetText;
+    }
+    return false;
+  };
 
+  for (auto &block : proc.orderedBlocksReference()) {
+    // every instruction gets its own name for the range, loaded right before
+    // and stored right after it
+    std::vector<Instruction> newInstructions;
+    std::string label;
+
+    for (auto inst : block.instructions) {
+      std::unique_ptr<Value> piece;
+      bool uses = false;
+      bool defines = false;
+
+      if (!inst.isDeleted() && connectsPiece(inst)) {
+        // keep its label for the next instruction
+        label = inst.label;
+        continue;
+      }
+      if (label != "") {
+        inst.label = label;
+        label = "";
+      }
+
+      if (!inst.isDeleted()) {
+        for (auto &rval : inst.operation.rvalues) {
+          if (inRange(rval)) {
+            if (!piece)
+              piece.reset(new Value(createSplitValue(rval)));
+            rval = *piece;
+            uses = true;
+          }
+        }
+        for (auto &lval : inst.operation.lvalues) {
+          if (inRange(lval)) {
+            if (!piece)
+              piece.reset(new Value(createSplitValue(lval)));
+            lval = *piece;
+            defines = true;
+          }
+        }
+      }
+
+      newInstructions.push_back(inst);
+      if (uses) {
+        createReload(range, *piece, offset, newInstructions,
+                     --newInstructions.end());
+      }
+      if (defines) {
+        createStoreAIInst(*piece, offset, newInstructions,
+                          newInstructions.end());
+      }
+
+      if (piece) {
+        // these can't get any smaller, never spill them again
+        spilledSet.insert(
+            LiveRange{piece->getFullText(), {*piece}, 0, nullptr});
+      }
+    }
+
+    block.instructions = newInstructions;
+  }
+
+  if (range.remat) {
+    _rematMap[proc.getFrame().name].insert(range.name);
+  }
+  spilledSet.insert(range);
+}
+
+Value RegisterAllocationPass::createSplitValue(const Value &original) {
+  // ssa subscripts are numbers, so these can't clash with them
+  Value value = original;
+  value.setSubscript("s" + std::to_string(_splitValues++));
+  return value;
+}
+
+unsigned int RegisterAllocationPass::getSpillOffset(
+    IlocProcedure &proc, const std::string &rangeName) {
+  // see if we already have an offset for the range
+  std::unordered_map<std::string, unsigned int> &offsetMap =
+      _offsetMap[proc.getFrame().name];
+
+  if (offsetMap.find(rangeName) != offsetMap.end()) {
+    return offsetMap.at(rangeName);
+  }
+
+  unsigned int offset = growFrame(proc);
+  offsetMap.insert({rangeName, offset});
+
+  return offset;
+}
+
+bool RegisterAllocationPass::isSpillSlot(const IlocProcedure &proc,
+                                         const Value &base,
+                                         const Value &offset,
+                                         const std::string &rangeName) const {
+  // loads and stores of the program's own locals go through the frame
+  // pointer as well, only the range's slot counts
+  auto frame = _offsetMap.find(proc.getFrame().name);
+  if (frame == _offsetMap.end())
+    return false;
+
+  auto it = frame->second.find(rangeName);
+  return it != frame->second.end() && base.getName() == "%vr0" &&
+         offset.getName() == "-" + std::to_string(it->second);
+}
+
+void RegisterAllocationPass::createReload(
+    const LiveRange &range, Value value, unsigned int offset,
+    std::vector<Instruction> &list, std::vector<Instruction>::iterator pos) {
+  if (range.remat) {
+    createRematInst(*range.remat, value, list, pos);
+  } else {
+    createLoadAIInst(value, offset, list, pos);
+  }
+}
+
+void RegisterAllocationPass::remapNames(IlocProcedure &proc,
+                                        InterferenceGraph &graph,
+                                        const LiveRanges &liveRanges) {
   // map arguments
   for (auto &arg : proc.getFrameReference().arguments) {
     if (arg.getType() == Value::Type::virtualReg) {
-      LiveRange liveRange = utilLRPass.getRangeWithValue(arg, liveRanges);
-      InterferenceGraphNode node = graph.getNode(liveRange.name);
+      const LiveRange &liveRange = liveRanges.getRangeWithValue(arg);
+      const InterferenceGraphNode &node = graph.getNode(liveRange.id);
 
       arg.setSubscript(arg.getFullText());
       arg.setName("%vr" + std::to_string(node.color));
@@ -334,9 +659,7 @@ void RegisterAllocationPass::remapNames(IlocProcedure &proc,
   }
 
   // map instructions
-  for (auto blockCopy : proc.orderedBlocks()) {
-    BasicBlock &block = proc.getBlockReference(blockCopy.debugName);
-
+  for (auto &block : proc.orderedBlocksReference()) {
     for (auto &inst : block.instructions) {
       if (inst.isDeleted()) {
         continue;
@@ -344,8 +667,8 @@ void RegisterAllocationPass::remapNames(IlocProcedure &proc,
 
       for (auto &lval : inst.operation.lvalues) {
         if (lval.getType() == Value::Type::virtualReg) {
-          LiveRange liveRange = utilLRPass.getRangeWithValue(lval, liveRanges);
-          InterferenceGraphNode node = graph.getNode(liveRange.name);
+          const LiveRange &liveRange = liveRanges.getRangeWithValue(lval);
+          const InterferenceGraphNode &node = graph.getNode(liveRange.id);
 
           lval.setSubscript(lval.getFullText());
           lval.setName("%vr" + std::to_string(node.color));
@@ -354,13 +677,21 @@ void RegisterAllocationPass::remapNames(IlocProcedure &proc,
 
       for (auto &rval : inst.operation.rvalues) {
         if (rval.getType() == Value::Type::virtualReg) {
-          LiveRange liveRange = utilLRPass.getRangeWithValue(rval, liveRanges);
-          InterferenceGraphNode node = graph.getNode(liveRange.name);
+          const LiveRange &liveRange = liveRanges.getRangeWithValue(rval);
+          const InterferenceGraphNode &node = graph.getNode(liveRange.id);
 
           rval.setSubscript(rval.getFullText());
           rval.setName("%vr" + std::to_string(node.color));
         }
       }
+
+      // copies between ranges that ended up in the same register do nothing
+      if (inst.operation.opcode == ilocParser::I2I && inst.label == "" &&
+          inst.operation.rvalues.front().getName() ==
+              inst.operation.lvalues.front().getName()) {
+        inst.markAsDeleted();
+        _removedMoves++;
+      }
     }
   }
 }
\ No newline at end of file
@@ -2,25 +2,68 @@
 
 #include "interferencegraph.h"
 #include "pass.h"
+#include "targetmachine.h"
 
 class RegisterAllocationPass : public Pass {
 public:
-  IlocProgram applyToProgram(IlocProgram prog);
+  // what to do with live ranges that couldn't be colored.
+  // everywhere: store after every definition and load before every use.
+  // split: cut the range into one piece per block, passing values between
+  // blocks through memory. pieces that still can't be colored are split again
+  // around each instruction that references them.
+  enum class SpillMode { everywhere, split };
+
+  RegisterAllocationPass(const TargetMachine &target,
+                         SpillMode mode = SpillMode::everywhere);
+  void run(IlocProgram &prog);
 
 private:
-  void colorGraph(InterferenceGraph &igraph, unsigned int k);
+  void colorGraph(InterferenceGraph &igraph);
+  // brings liveness and the uncolored graph up to date after the ranges the
+  // colored graph couldn't color were spilled everywhere
+  void updateSpilled(const IlocProcedure &proc, InterferenceGraph &pristine,
+                     const InterferenceGraph &colored, LiveRangesPass &lrpass,
+                     LiveVariableAnalysisPass<HardValueSet> &lvapass,
+                     const std::vector<unsigned int> &loopDepths,
+                     const std::set<LiveRange> &spilledSet);
   bool spillRegisters(IlocProcedure &proc, InterferenceGraph &igraph,
-                      LiveRangesPass lrpass, std::set<LiveRange> &spilledSet);
-  void createStoreAIInst(Value value, LiveRange valueRange, IlocProcedure &proc,
-                         std::vector<Instruction> &list,
-                         std::vector<Instruction>::iterator pos);
-  void createLoadAIInst(Value value, LiveRange valueRange, IlocProcedure &proc,
-                        std::vector<Instruction> &list,
-                        std::vector<Instruction>::iterator pos);
-  void remapNames(IlocProcedure &proc, InterferenceGraph graph,
-                  std::set<LiveRange> liveRanges);
-  std::unordered_map<std::string, std::unordered_map<LiveRange, unsigned int>>
+                      LiveRangesPass &lrpass,
+                      LiveVariableAnalysisPass<HardValueSet> &lvapass,
+                      std::set<LiveRange> &spilledSet);
+  bool splitRanges(IlocProcedure &proc, InterferenceGraph &igraph,
+                   LiveRangesPass &lrpass,
+                   LiveVariableAnalysisPass<HardValueSet> &lvapass,
+                   std::set<LiveRange> &spilledSet);
+  void splitAtBlocks(IlocProcedure &proc, const LiveRange &range,
+                     LiveVariableAnalysisPass<HardValueSet> &lvapass);
+  void splitAtReferences(IlocProcedure &proc, const LiveRange &range,
+                         std::set<LiveRange> &spilledSet);
+  Value createSplitValue(const Value &original);
+  unsigned int getSpillOffset(IlocProcedure &proc,
+                              const std::string &rangeName);
+  bool isSpillSlot(const IlocProcedure &proc, const Value &base,
+                   const Value &offset, const std::string &rangeName) const;
+  void createReload(const LiveRange &range, Value value, unsigned int offset,
+                    std::vector<Instruction> &list,
+                    std::vector<Instruction>::iterator pos);
+  void remapNames(IlocProcedure &proc, InterferenceGraph &graph,
+                  const LiveRanges &liveRanges);
+
+  const TargetMachine &_target;
+  const SpillMode _mode;
+  // procedure name -> live range name -> stack offset
+  std::unordered_map<std::string, std::unordered_map<std::string, unsigned int>>
       _offsetMap;
+  // procedure name -> live ranges that are already one block long
+  std::unordered_map<std::string, std::unordered_set<std::string>> _pieceMap;
+  unsigned int _splitValues;
+  // procedure name -> live ranges recomputed instead of spilled
+  std::unordered_map<std::string, std::unordered_set<std::string>>
+      _rematMap;
   std::unordered_map<std::string, bool> _dirtyMap;
+  unsigned int _removedMoves;
+  // procedure name -> graph as built, before coloring took it apart
   std::unordered_map<std::string, InterferenceGraph> _graphMap;
+  // procedure name -> graph colored in the last round
+  std::unordered_map<std::string, InterferenceGraph> _coloredMap;
 };
@@ -1,7 +1,7 @@
 #include "registerbehaviorpass.h"
 
-IlocProgram RegisterBehaviorPass::applyToProgram(IlocProgram prog) {
-  _DTreePass.applyToProgram(prog);
+void RegisterBehaviorPass::run(IlocProgram &prog) {
+  _DTreePass.run(prog);
 
   std::cerr << "determining register behaviors\n";
 
@@ -9,23 +9,17 @@ IlocProgram RegisterBehaviorPass::applyToProgram(IlocProgram prog) {
     _knownBehaviorMap.clear();
     setRegisterBehaviors(proc, proc.getBlockReference("entry"));
   }
-
-  return prog;
 }
 
 void RegisterBehaviorPass::setRegisterBehaviors(IlocProcedure &proc,
                                                 BasicBlock &block) {
   // postorder
-  for (auto child : _DTreePass.getDominatorTree(proc)
-                        .findNodeByBlockname(block.debugName)
-                        .getChildren()) {
-    BasicBlock &next = proc.getBlockReference(child.getBasicBlock().debugName);
+  for (auto childId : _DTreePass.getDominatorTree(proc).getChildren(block.id)) {
+    BasicBlock &next = proc.getBlockReference(childId);
     setRegisterBehaviors(proc, next);
   }
 
-  for (auto blockCopy : proc.orderedBlocks()) {
-    auto &block = proc.getBlockReference(blockCopy.debugName);
-
+  for (auto &block : proc.orderedBlocksReference()) {
     for (auto &inst : block.instructions) {
       if (inst.operation.category == Operation::Category::memory) {
         for (auto &lval : inst.operation.lvalues) {
@@ -5,7 +5,7 @@
 
 class RegisterBehaviorPass : public Pass {
 public:
-  IlocProgram applyToProgram(IlocProgram prog);
+  void run(IlocProgram &prog);
 
 private:
   void setRegisterBehaviors(IlocProcedure &proc, BasicBlock &block);
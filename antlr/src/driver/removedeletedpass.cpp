@@ -1,25 +1,16 @@
-#include "removedeletedpass.h"
-
-IlocProgram RemoveDeletedPass::applyToProgram(IlocProgram program) {
-  IlocProgram newProgram = program;
+#include <algorithm>
 
-  newProgram.clearProcedures();
+#include "removedeletedpass.h"
 
-  for (IlocProcedure proc : program.getProcedures()) {
-    IlocProcedure newProc = proc;
-    newProc.clearBlocks();
-    for (BasicBlock block : proc.orderedBlocks()) {
-      BasicBlock newBlock = block;
-      newBlock.instructions.clear();
-      for (Instruction inst : block.instructions) {
-        if (inst.isDeleted() != true) {
-          newBlock.instructions.push_back(inst);
-        }
-      }
-      newProc.addBlock(newBlock.debugName, newBlock);
+void RemoveDeletedPass::run(IlocProgram &program) {
+  for (auto &proc : program.getProceduresReference()) {
+    for (auto &block : proc.orderedBlocksReference()) {
+      block.instructions.erase(
+          std::remove_if(block.instructions.begin(), block.instructions.end(),
+                         [](const Instruction &inst) {
+                           return inst.isDeleted() == true;
+                         }),
+          block.instructions.end());
     }
-    newProgram.addProcedure(newProc);
   }
-
-  return newProgram;
 }
@@ -4,7 +4,7 @@
 
 class RemoveDeletedPass : public Pass {
 public:
-  IlocProgram applyToProgram(IlocProgram program) override;
+  void run(IlocProgram &program) override;
 
 private:
 };
@@ -0,0 +1,301 @@
+#include <map>
+#include <set>
+
+#include "spillcode.h"
+
+unsigned int growFrame(IlocProcedure &proc) {
+  unsigned int offset = std::stoi(proc.getFrame().number) + 4;
+  proc.getFrameReference().number = std::to_string(offset);
+  return offset;
+}
+
+void createStoreAIInst(Value value, unsigned int offset,
+                       std::vector<Instruction> &list,
+                       std::vector<Instruction>::iterator pos) {
+
+  // create the storeai instruction
+  Operation op(ilocParser::STOREAI);
+  Value rval = value;
+  Value lval =
+      Value("%vr0", Value::Type::virtualReg, Value::Behavior::expression);
+  lval.setSubscript("0");
+  Value offsetValue = Value("-" + std::to_string(offset), Value::Type::number,
+                            Value::Behavior::expression);
+
+  op.rvalues.push_back(rval);
+  op.rvalues.push_back(lval);
+  op.rvalues.push_back(offsetValue);
+  op.arrow = "=>";
+
+  // insert it
+  list.insert(pos, Instruction(op));
+}
+
+void createLoadAIInst(Value value, unsigned int offset,
+                      std::vector<Instruction> &list,
+                      std::vector<Instruction>::iterator pos) {
+
+  // create the loadai instruction
+  Operation op(ilocParser::LOADAI);
+  Value lval = value;
+  Value rval =
+      Value("%vr0", Value::Type::virtualReg, Value::Behavior::expression);
+  rval.setSubscript("0");
+  Value offsetValue = Value("-" + std::to_string(offset), Value::Type::number,
+                            Value::Behavior::expression);
+
+  op.rvalues.push_back(rval);
+  op.rvalues.push_back(offsetValue);
+  op.lvalues.push_back(lval);
+  op.arrow = "=>";
+
+  Instruction load(op);
+
+  // branches to a labeled instruction have to reach the load as well
+  if (pos != list.end() && pos->label != "") {
+    load.label = pos->label;
+    pos->label = "";
+  }
+
+  // insert it
+  list.insert(pos, load);
+}
+
+void createRematInst(const Operation &remat, Value value,
+                     std::vector<Instruction> &list,
+                     std::vector<Instruction>::iterator pos) {
+
+  // recompute the value with the operation that defined it
+  Operation op = remat;
+  op.lvalues.push_back(value);
+
+  Instruction inst(op);
+
+  // branches to a labeled instruction have to reach it as well
+  if (pos != list.end() && pos->label != "") {
+    inst.label = pos->label;
+    pos->label = "";
+  }
+
+  // insert it
+  list.insert(pos, inst);
+}
+
+static TargetMachine::RegisterClass classOf(
+    const Value &value,
+    const std::unordered_map<Value, TargetMachine::RegisterClass> &classes) {
+  auto it = classes.find(value);
+  return it == classes.end() ? TargetMachine::RegisterClass::integer
+                             : it->second;
+}
+
+// the arguments of a call or return that give their registers up to its
+// return value. the value takes the last register of its class, so those are
+// the arguments of the class past the one before it.
+static std::vector<bool> overwrittenArguments(
+    uint opcode, const std::vector<Value> &arguments,
+    const std::unordered_map<Value, TargetMachine::RegisterClass> &classes,
+    const TargetMachine &target) {
+  std::vector<bool> overwritten(arguments.size(), false);
+  if (opcode != ilocParser::ICALL && opcode != ilocParser::IRET &&
+      opcode != ilocParser::FCALL && opcode != ilocParser::FRET) {
+    return overwritten;
+  }
+
+  TargetMachine::RegisterClass returned = target.getAllocationClass(
+      opcode == ilocParser::ICALL || opcode == ilocParser::IRET
+          ? TargetMachine::RegisterClass::integer
+          : TargetMachine::RegisterClass::floating);
+  unsigned int registers = target.getAllocatableRegisters(returned);
+  unsigned int passed = 0;
+  for (unsigned int i = 0; i < arguments.size(); i++) {
+    if (arguments[i].getType() == Value::Type::virtualReg &&
+        classOf(arguments[i], classes) == returned) {
+      overwritten[i] = ++passed >= registers;
+    }
+  }
+  return overwritten;
+}
+
+std::vector<bool> overwrittenArguments(const IlocProcedure &proc,
+                                       const TargetMachine &target) {
+  // a procedure can also fall off its end with a plain ret
+  uint opcode = ilocParser::RET;
+  for (auto predId : proc.getBlock(proc.getExitBlockId()).before) {
+    const auto &instructions = proc.getBlock(predId).instructions;
+    if (!instructions.empty() &&
+        (instructions.back().operation.opcode == ilocParser::IRET ||
+         instructions.back().operation.opcode == ilocParser::FRET)) {
+      opcode = instructions.back().operation.opcode;
+    }
+  }
+  return overwrittenArguments(opcode, proc.getFrame().arguments,
+                              target.classifyValues(proc), target);
+}
+
+std::vector<unsigned int> overwrittenRanges(const IlocProcedure &proc,
+                                            const LiveRanges &ranges,
+                                            const TargetMachine &target) {
+  std::unordered_map<Value, TargetMachine::RegisterClass> classes =
+      target.classifyValues(proc);
+  std::set<unsigned int> ids;
+  for (const auto &block : proc.orderedBlocks()) {
+    for (const auto &inst : block.instructions) {
+      if (inst.isDeleted())
+        continue;
+
+      const Operation &op = inst.operation;
+      std::vector<bool> overwritten =
+          overwrittenArguments(op.opcode, op.rvalues, classes, target);
+      for (const auto &pair : op.getWrittenArguments()) {
+        const LiveRange &range =
+            ranges.getRangeWithValue(op.lvalues[pair.second]);
+        if (overwritten[pair.first] &&
+            target.getReservedRegister(range.name) == -1) {
+          ids.insert(range.id);
+        }
+      }
+    }
+  }
+  return std::vector<unsigned int>(ids.begin(), ids.end());
+}
+
+void dropOverwrittenArguments(IlocProcedure &proc, const LiveRanges &ranges,
+                              const std::unordered_set<unsigned int> &spilled,
+                              const TargetMachine &target) {
+  std::unordered_map<Value, TargetMachine::RegisterClass> classes =
+      target.classifyValues(proc);
+  for (auto &block : proc.orderedBlocksReference()) {
+    for (auto &inst : block.instructions) {
+      Operation &op = inst.operation;
+      auto written = op.getWrittenArguments();
+      if (inst.isDeleted() || written.empty())
+        continue;
+
+      std::vector<bool> overwritten =
+          overwrittenArguments(op.opcode, op.rvalues, classes, target);
+      std::vector<bool> dropped(op.lvalues.size(), false);
+      for (const auto &pair : written) {
+        dropped[pair.second] =
+            overwritten[pair.first] &&
+            spilled.find(ranges.getRangeWithValue(op.lvalues[pair.second])
+                             .id) != spilled.end();
+      }
+
+      std::vector<Value> lvalues;
+      for (unsigned int i = 0; i < op.lvalues.size(); i++) {
+        if (!dropped[i]) {
+          lvalues.push_back(op.lvalues[i]);
+        }
+      }
+      op.lvalues = lvalues;
+    }
+  }
+}
+
+void spillLiveRanges(
+    IlocProcedure &proc, const LiveRanges &ranges,
+    const std::vector<unsigned int> &ids,
+    const std::unordered_map<unsigned int, unsigned int> &offsets,
+    std::unordered_set<Value> &pieces, unsigned int &pieceCount,
+    const TargetMachine &target) {
+  std::unordered_set<unsigned int> spilled(ids.begin(), ids.end());
+  dropOverwrittenArguments(proc, ranges, spilled, target);
+
+  for (auto &block : proc.orderedBlocksReference()) {
+    std::vector<Instruction> newInstructions;
+    newInstructions.reserve(block.instructions.size());
+    std::string label;
+
+    for (auto inst : block.instructions) {
+      // range id -> its name in this instruction
+      std::map<unsigned int, Value> names;
+      std::set<unsigned int> uses;
+      std::set<unsigned int> definitions;
+
+      auto rename = [&](Value &value, std::set<unsigned int> &references) {
+        if (value.getType() != Value::Type::virtualReg)
+          return;
+
+        unsigned int id = ranges.getRangeWithValue(value).id;
+        if (spilled.find(id) == spilled.end())
+          return;
+
+        auto it = names.find(id);
+        if (it == names.end()) {
+          Value piece = value;
+          piece.setSubscript("s" + std::to_string(pieceCount++));
+          it = names.insert({id, piece}).first;
+          pieces.insert(piece);
+        }
+        value = it->second;
+        references.insert(id);
+      };
+
+      if (!inst.isDeleted()) {
+        for (auto &rval : inst.operation.rvalues) {
+          rename(rval, uses);
+        }
+        for (auto &lval : inst.operation.lvalues) {
+          rename(lval, definitions);
+        }
+      }
+
+      // a rematerialized range is recomputed at its uses, so its definitions
+      // go away. their labels move to the next instruction.
+      if (uses.empty() && definitions.size() == 1 &&
+          ranges.getRange(*definitions.begin()).remat) {
+        label = inst.label;
+        continue;
+      }
+      if (label != "") {
+        inst.label = label;
+        label = "";
+      }
+
+      newInstructions.push_back(inst);
+      for (auto id : uses) {
+        const LiveRange &range = ranges.getRange(id);
+        if (range.remat) {
+          createRematInst(*range.remat, names.at(id), newInstructions,
+                          --newInstructions.end());
+        } else {
+          createLoadAIInst(names.at(id), offsets.at(id), newInstructions,
+                           --newInstructions.end());
+        }
+      }
+      for (auto id : definitions) {
+        if (!ranges.getRange(id).remat) {
+          createStoreAIInst(names.at(id), offsets.at(id), newInstructions,
+                            newInstructions.end());
+        }
+      }
+    }
+
+    block.instructions = newInstructions;
+  }
+}
+
+void spillArgument(IlocProcedure &proc, const Value &argValue,
+                   unsigned int offset, const TargetMachine &target) {
+  // the argument arrives in its register, and because it is passed by
+  // reference it has to be back in it before returning, unless the return
+  // value overwrites it
+  BasicBlock &entryBlock = proc.getBlockReference("entry");
+  createStoreAIInst(argValue, offset, entryBlock.instructions,
+                    entryBlock.instructions.begin());
+
+  const std::vector<Value> arguments = proc.getFrame().arguments;
+  std::vector<bool> overwritten = overwrittenArguments(proc, target);
+  for (unsigned int i = 0; i < arguments.size(); i++) {
+    if (arguments[i] == argValue && overwritten[i])
+      return;
+  }
+
+  const BasicBlock &exitBlock = proc.getBlock(proc.getExitBlockId());
+  for (auto predId : exitBlock.before) {
+    auto &predInstructions = proc.getBlockReference(predId).instructions;
+    createLoadAIInst(argValue, offset, predInstructions,
+                     --predInstructions.end());
+  }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ilocprocedure.h"
+#include "liverangespass.h"
+#include "targetmachine.h"
+
+// instructions the register allocators insert to keep a live range on the
+// stack or to recompute it. slots are addressed as negative offsets from
+// %vr0. loads and recomputations take over the label of the instruction they
+// are inserted in front of, so branches to it reach them too.
+
+// adds a 4 byte slot to the end of the procedure's frame and returns its
+// offset
+unsigned int growFrame(IlocProcedure &proc);
+
+void createStoreAIInst(Value value, unsigned int offset,
+                       std::vector<Instruction> &list,
+                       std::vector<Instruction>::iterator pos);
+void createLoadAIInst(Value value, unsigned int offset,
+                      std::vector<Instruction> &list,
+                      std::vector<Instruction>::iterator pos);
+void createRematInst(const Operation &remat, Value value,
+                     std::vector<Instruction> &list,
+                     std::vector<Instruction>::iterator pos);
+
+// gives every instruction that references one of the spilled ranges its own
+// name for it, loaded or recomputed right before the instruction and stored
+// right after it. offsets holds the slot of every spilled range that isn't
+// rematerialized. the new names are added to pieces, numbered from
+// pieceCount on.
+//
+// arguments the callee's return value overwrites aren't written back to the
+// spilled ranges, see dropOverwrittenArguments.
+void spillLiveRanges(
+    IlocProcedure &proc, const LiveRanges &ranges,
+    const std::vector<unsigned int> &ids,
+    const std::unordered_map<unsigned int, unsigned int> &offsets,
+    std::unordered_set<Value> &pieces, unsigned int &pieceCount,
+    const TargetMachine &target);
+// a return reads the return value along with every argument, which can take
+// more registers of the return value's class than the target hands out. the
+// last arguments of the class then give theirs up to the return value: they
+// aren't loaded back once they're spilled, and aren't written back to the
+// caller.
+//
+// whether each argument of the procedure is one of them
+std::vector<bool> overwrittenArguments(const IlocProcedure &proc,
+                                       const TargetMachine &target);
+// ranges a call writes one of them back to. whatever the callee returns in
+// their registers would overwrite the ranges, so they have to be spilled.
+std::vector<unsigned int> overwrittenRanges(const IlocProcedure &proc,
+                                            const LiveRanges &ranges,
+                                            const TargetMachine &target);
+// calls stop writing back the spilled ones of those ranges. they keep the
+// value they were passed in their slot, as they do when spilling everywhere.
+void dropOverwrittenArguments(IlocProcedure &proc, const LiveRanges &ranges,
+                              const std::unordered_set<unsigned int> &spilled,
+                              const TargetMachine &target);
+// stores an argument on entry and loads it back on every way to the exit,
+// unless the return value overwrites it
+void spillArgument(IlocProcedure &proc, const Value &argValue,
+                   unsigned int offset, const TargetMachine &target);
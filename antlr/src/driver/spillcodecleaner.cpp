@@ -0,0 +1,168 @@
+#include "spillcodecleaner.h"
+
+SpillCodeCleaner::SpillCodeCleaner(IlocProcedure &proc,
+                                   const std::set<unsigned int> &slots)
+    : _proc(proc), _empty(slots.empty()) {
+  // spill slots are handed out 4 bytes at a time past the end of the frame,
+  // and packing them keeps them there
+  _base = slots.empty() ? std::stoi(proc.getFrame().number)
+                        : *slots.begin() - 4;
+}
+
+unsigned int SpillCodeCleaner::getRemovedLoads() const {
+  return _removedLoads;
+}
+
+unsigned int SpillCodeCleaner::getRemovedStores() const {
+  return _removedStores;
+}
+
+void SpillCodeCleaner::clean() {
+  if (_empty)
+    return;
+
+  for (auto &block : _proc.orderedBlocksReference()) {
+    cleanBlock(block);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SpillCodeCleaner::Access
+SpillCodeCleaner::getAccess(const Instruction &inst, std::string &slot) const {
+  if (inst.isDeleted())
+    return Access::none;
+
+  const Operation &op = inst.operation;
+  Access access = Access::none;
+
+  if (op.opcode == ilocParser::LOADAI && op.rvalues[0].getName() == "%vr0") {
+    access = Access::load;
+    slot = op.rvalues[1].getName();
+  } else if (op.opcode == ilocParser::STOREAI &&
+             op.rvalues[1].getName() == "%vr0") {
+    access = Access::store;
+    slot = op.rvalues[2].getName();
+  }
+
+  // locals of the frame itself aren't spill slots
+  if (access == Access::none || -std::stoi(slot) <= static_cast<int>(_base)) {
+    return Access::none;
+  }
+  return access;
+}
+
+void SpillCodeCleaner::cleanBlock(BasicBlock &block) {
+  _holders.clear();
+  _unreadStores.clear();
+
+  for (unsigned int i = 0; i < block.instructions.size(); i++) {
+    Instruction &inst = block.instructions[i];
+    if (inst.isDeleted())
+      continue;
+
+    Operation &op = inst.operation;
+    std::string slot;
+    Access access = getAccess(inst, slot);
+
+    if (access == Access::load) {
+      std::string reg = op.lvalues.front().getName();
+      std::string holder = findHolder(slot);
+
+      if (holder == reg) {
+        remove(inst);
+        _removedLoads++;
+        continue;
+      }
+
+      // only a load that stays reads the store before it
+      forgetRegister(reg);
+      if (holder != "") {
+        inst.changeToMove(holder);
+        _removedLoads++;
+      } else {
+        _unreadStores.erase(slot);
+      }
+      _holders[reg] = slot;
+      continue;
+    }
+
+    if (access == Access::store) {
+      std::string reg = op.rvalues.front().getName();
+
+      // the slot already has the register's value
+      auto holder = _holders.find(reg);
+      if (holder != _holders.end() && holder->second == slot) {
+        remove(inst);
+        _removedStores++;
+        continue;
+      }
+
+      // nothing loaded the value stored before this one
+      auto unread = _unreadStores.find(slot);
+      if (unread != _unreadStores.end()) {
+        remove(block.instructions[unread->second]);
+        _removedStores++;
+      }
+
+      forgetSlot(slot);
+      _unreadStores[slot] = i;
+      _holders[reg] = slot;
+      continue;
+    }
+
+    // a call overwrites the registers of all of its arguments, also those
+    // it doesn't write back because the callee returns over them
+    if (op.opcode == ilocParser::CALL || op.opcode == ilocParser::ICALL ||
+        op.opcode == ilocParser::FCALL) {
+      for (const auto &rval : op.rvalues) {
+        forgetRegister(rval.getName());
+      }
+    }
+
+    // a call's lvalues are the arguments its callee can write back
+    for (const auto &lval : op.lvalues) {
+      if (lval.getType() != Value::Type::virtualReg)
+        continue;
+
+      // every slot is addressed through the frame pointer
+      if (lval.getName() == "%vr0") {
+        _holders.clear();
+        _unreadStores.clear();
+      }
+      forgetRegister(lval.getName());
+    }
+  }
+}
+
+std::string SpillCodeCleaner::findHolder(const std::string &slot) const {
+  for (const auto &pair : _holders) {
+    if (pair.second == slot) {
+      return pair.first;
+    }
+  }
+  return "";
+}
+
+void SpillCodeCleaner::forgetRegister(const std::string &reg) {
+  _holders.erase(reg);
+}
+
+void SpillCodeCleaner::forgetSlot(const std::string &slot) {
+  for (auto it = _holders.begin(); it != _holders.end();) {
+    if (it->second == slot) {
+      it = _holders.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+void SpillCodeCleaner::remove(Instruction &inst) {
+  // a label has to stay where it is
+  if (inst.label == "") {
+    inst.markAsDeleted();
+  } else {
+    inst.operation = Operation(ilocParser::NOP);
+  }
+}
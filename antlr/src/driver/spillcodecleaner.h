@@ -0,0 +1,52 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ilocprocedure.h"
+
+// cleans up the spill code of a procedure once its values have registers.
+// within a block it tracks which registers still hold the value of which spill
+// slot. a load of a slot into a register that already holds it goes away, and
+// a load of a slot that another register holds becomes a copy. a store of a
+// register into the slot it holds goes away, and so does a store that is
+// overwritten before the slot is loaded again. nothing is assumed about the
+// slots when a block is entered.
+class SpillCodeCleaner {
+public:
+  // slots are the offsets below %vr0 that were given to spilled ranges, as
+  // for SpillSlotAllocator. the program itself never addresses anything past
+  // the frame's own locals, so only its direct loads and stores can touch
+  // them.
+  SpillCodeCleaner(IlocProcedure &proc, const std::set<unsigned int> &slots);
+  void clean();
+  unsigned int getRemovedLoads() const;
+  unsigned int getRemovedStores() const;
+
+private:
+  enum class Access { none, load, store };
+
+  // what inst does with a spill slot, and which one
+  Access getAccess(const Instruction &inst, std::string &slot) const;
+  void cleanBlock(BasicBlock &block);
+  // the register holding slot, empty if there is none
+  std::string findHolder(const std::string &slot) const;
+  void forgetRegister(const std::string &reg);
+  void forgetSlot(const std::string &slot);
+  void remove(Instruction &inst);
+
+  IlocProcedure &_proc;
+  // size of the frame without any spill slots
+  unsigned int _base;
+  bool _empty;
+
+  // register -> slot whose value it holds
+  std::unordered_map<std::string, std::string> _holders;
+  // slot -> position of a store to it in the block that nothing has loaded
+  // yet
+  std::unordered_map<std::string, unsigned int> _unreadStores;
+  unsigned int _removedLoads = 0;
+  unsigned int _removedStores = 0;
+};
@@ -0,0 +1,181 @@
+#include <algorithm>
+
+#include "spillslotallocator.h"
+
+SpillSlotAllocator::SpillSlotAllocator(IlocProcedure &proc,
+                                       const std::set<unsigned int> &slots)
+    : _proc(proc), _offsets(slots.begin(), slots.end()) {
+  for (unsigned int slot = 0; slot < _offsets.size(); slot++) {
+    _slotNumbers.insert({"-" + std::to_string(_offsets[slot]), slot});
+  }
+
+  // spill slots are handed out 4 bytes at a time past the end of the frame
+  _base = _offsets.empty() ? std::stoi(proc.getFrame().number)
+                           : _offsets.front() - 4;
+}
+
+unsigned int SpillSlotAllocator::getSlotCount() const { return _slotCount; }
+
+void SpillSlotAllocator::allocate() {
+  if (_offsets.empty())
+    return;
+
+  Problem problem(*this);
+  DataFlowSolver<Problem> solver(problem);
+  solver.solve(_proc);
+
+  buildInterference(solver);
+  assignSlots();
+  rewrite();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SpillSlotAllocator::Access
+SpillSlotAllocator::getAccess(const Instruction &inst,
+                              unsigned int &slot) const {
+  if (inst.isDeleted())
+    return Access::none;
+
+  const Operation &op = inst.operation;
+  Access access = Access::none;
+  std::string offset;
+
+  if (op.opcode == ilocParser::LOADAI && op.rvalues[0].getName() == "%vr0") {
+    access = Access::load;
+    offset = op.rvalues[1].getName();
+  } else if (op.opcode == ilocParser::STOREAI &&
+             op.rvalues[1].getName() == "%vr0") {
+    access = Access::store;
+    offset = op.rvalues[2].getName();
+  }
+
+  // locals of the frame itself aren't spill slots
+  auto it = _slotNumbers.find(offset);
+  if (access == Access::none || it == _slotNumbers.end()) {
+    return Access::none;
+  }
+
+  slot = it->second;
+  return access;
+}
+
+void SpillSlotAllocator::buildInterference(
+    const DataFlowSolver<Problem> &solver) {
+  unsigned int size = _offsets.size();
+  _interference.assign(size, BitVector(size));
+
+  auto connect = [&](unsigned int a, unsigned int b) {
+    if (a != b) {
+      _interference[a].set(b);
+      _interference[b].set(a);
+    }
+  };
+
+  // a store interferes with every other slot that is live across it
+  for (const auto &block : _proc.orderedBlocks()) {
+    BitVector live = solver.getOut(block.id);
+
+    for (auto it = block.instructions.rbegin(); it != block.instructions.rend();
+         it++) {
+      unsigned int slot;
+      Access access = getAccess(*it, slot);
+
+      if (access == Access::store) {
+        live.forEach([&](unsigned int other) { connect(slot, other); });
+        live.reset(slot);
+      } else if (access == Access::load) {
+        live.set(slot);
+      }
+    }
+  }
+
+  // slots that may be loaded before they're stored are all live on entry
+  const BitVector &entry = solver.getIn(_proc.getBlockId("entry"));
+  entry.forEach([&](unsigned int a) {
+    entry.forEach([&](unsigned int b) { connect(a, b); });
+  });
+}
+
+void SpillSlotAllocator::assignSlots() {
+  // first fit, in the order the slots were handed out
+  unsigned int size = _offsets.size();
+  _assigned.assign(size, 0);
+  _slotCount = 0;
+
+  for (unsigned int slot = 0; slot < size; slot++) {
+    std::vector<bool> taken(size, false);
+    _interference[slot].forEach([&](unsigned int other) {
+      if (other < slot) {
+        taken[_assigned[other]] = true;
+      }
+    });
+
+    unsigned int packed = 0;
+    while (taken[packed]) {
+      packed++;
+    }
+
+    _assigned[slot] = packed;
+    _slotCount = std::max(_slotCount, packed + 1);
+  }
+}
+
+void SpillSlotAllocator::rewrite() {
+  for (auto &block : _proc.orderedBlocksReference()) {
+    for (auto &inst : block.instructions) {
+      unsigned int slot;
+      Access access = getAccess(inst, slot);
+      if (access == Access::none)
+        continue;
+
+      Value &offset = access == Access::load ? inst.operation.rvalues[1]
+                                             : inst.operation.rvalues[2];
+      offset.setName("-" + std::to_string(_base + 4 * (_assigned[slot] + 1)));
+    }
+  }
+
+  _proc.getFrameReference().number = std::to_string(_base + 4 * _slotCount);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SpillSlotAllocator::Problem::Problem(const SpillSlotAllocator &allocator)
+    : _allocator(allocator) {}
+
+SpillSlotAllocator::Problem::Summary
+SpillSlotAllocator::Problem::summarize(const BasicBlock &block) {
+  Summary summary = {top(), top()};
+  for (const auto &inst : block.instructions) {
+    unsigned int slot;
+    Access access = _allocator.getAccess(inst, slot);
+
+    if (access == Access::load && !summary.not_prsv.test(slot)) {
+      summary.gen.set(slot);
+    } else if (access == Access::store) {
+      summary.not_prsv.set(slot);
+    }
+  }
+  return summary;
+}
+
+BitVector SpillSlotAllocator::Problem::top() {
+  return BitVector(_allocator._offsets.size());
+}
+
+BitVector SpillSlotAllocator::Problem::boundary() {
+  // nothing is read from a spill slot after the procedure returns
+  return top();
+}
+
+void SpillSlotAllocator::Problem::meet(BitVector &into,
+                                       const BitVector &from) {
+  into.unionWith(from);
+}
+
+bool SpillSlotAllocator::Problem::transfer(const Summary &summary,
+                                           const BitVector &out,
+                                           BitVector &in) {
+  // in = gen | (out & ~not_prsv)
+  return in.assignUnionDifference(summary.gen, out, summary.not_prsv);
+}
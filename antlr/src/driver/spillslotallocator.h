@@ -0,0 +1,66 @@
+#pragma once
+
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "bitvector.h"
+#include "dataflowsolver.h"
+#include "ilocprocedure.h"
+
+// packs the stack slots handed out to spilled live ranges into as few slots
+// as possible. a slot is live from a store to it until its last load, slots
+// that are never live at the same time share an offset, and the frame shrinks
+// to fit the slots that are left.
+class SpillSlotAllocator {
+public:
+  // slots are the offsets below %vr0 that were given to spilled ranges. they
+  // all sit past the frame's own locals.
+  SpillSlotAllocator(IlocProcedure &proc, const std::set<unsigned int> &slots);
+  void allocate();
+  // number of slots left after packing
+  unsigned int getSlotCount() const;
+
+private:
+  // slot liveness as a backward union problem, the same shape as register
+  // liveness with loads as uses and stores as definitions
+  class Problem {
+  public:
+    struct Summary {
+      BitVector gen;
+      BitVector not_prsv;
+    };
+    using Lattice = BitVector;
+    static const DataFlowDirection direction = DataFlowDirection::backward;
+
+    Problem(const SpillSlotAllocator &allocator);
+    Summary summarize(const BasicBlock &block);
+    Lattice top();
+    Lattice boundary();
+    void meet(Lattice &into, const Lattice &from);
+    bool transfer(const Summary &summary, const Lattice &out, Lattice &in);
+
+  private:
+    const SpillSlotAllocator &_allocator;
+  };
+
+  enum class Access { none, load, store };
+
+  // what inst does with a spill slot, and which one
+  Access getAccess(const Instruction &inst, unsigned int &slot) const;
+  void buildInterference(const DataFlowSolver<Problem> &solver);
+  void assignSlots();
+  void rewrite();
+
+  IlocProcedure &_proc;
+  // offset -> slot number, and back
+  std::unordered_map<std::string, unsigned int> _slotNumbers;
+  std::vector<unsigned int> _offsets;
+  // size of the frame without any spill slots
+  unsigned int _base;
+
+  std::vector<BitVector> _interference;
+  // slot number -> packed slot, counting from 0
+  std::vector<unsigned int> _assigned;
+  unsigned int _slotCount = 0;
+};
@@ -0,0 +1,74 @@
+#include "ssalivenessproblem.h"
+
+SSALivenessProblem::SSALivenessProblem(
+    const IlocProcedure &proc,
+    const std::unordered_map<Value, unsigned int> &numbers, BitVector exit)
+    : _proc(proc), _numbers(numbers), _exit(std::move(exit)) {}
+
+void SSALivenessProblem::addPhiOperands(const BasicBlock &block,
+                                        BitVector &bits) const {
+  for (auto succ : block.after) {
+    for (const auto &phi : _proc.getBlock(succ).phinodes) {
+      if (phi.isDeleted())
+        continue;
+
+      auto it = phi.getRValueMap().find(block.id);
+      if (it != phi.getRValueMap().end()) {
+        bits.set(_numbers.at(it->second));
+      }
+    }
+  }
+}
+
+SSALivenessProblem::Summary
+SSALivenessProblem::summarize(const BasicBlock &block) {
+  Summary summary = {top(), top()};
+  for (const auto &phi : block.phinodes) {
+    if (!phi.isDeleted()) {
+      summary.not_prsv.set(_numbers.at(phi.getLValue()));
+    }
+  }
+
+  for (const auto &inst : block.instructions) {
+    if (inst.isDeleted())
+      continue;
+
+    for (const auto &rvalue : inst.operation.rvalues) {
+      if (rvalue.getType() == Value::Type::virtualReg) {
+        unsigned int n = _numbers.at(rvalue);
+        if (!summary.not_prsv.test(n)) {
+          summary.gen.set(n);
+        }
+      }
+    }
+    for (const auto &lvalue : inst.operation.lvalues) {
+      if (lvalue.getType() == Value::Type::virtualReg) {
+        summary.not_prsv.set(_numbers.at(lvalue));
+      }
+    }
+  }
+
+  BitVector operands = top();
+  addPhiOperands(block, operands);
+  operands.forEach([&](unsigned int n) {
+    if (!summary.not_prsv.test(n)) {
+      summary.gen.set(n);
+    }
+  });
+
+  return summary;
+}
+
+BitVector SSALivenessProblem::top() { return BitVector(_exit.size()); }
+
+BitVector SSALivenessProblem::boundary() { return _exit; }
+
+void SSALivenessProblem::meet(BitVector &into, const BitVector &from) {
+  into.unionWith(from);
+}
+
+bool SSALivenessProblem::transfer(const Summary &summary, const BitVector &out,
+                                  BitVector &in) {
+  // in = gen | (out & ~not_prsv)
+  return in.assignUnionDifference(summary.gen, out, summary.not_prsv);
+}
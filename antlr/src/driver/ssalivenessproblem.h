@@ -0,0 +1,41 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "bitvector.h"
+#include "dataflowsolver.h"
+#include "ilocprocedure.h"
+
+// liveness of the ssa values of a procedure, numbered densely, as a backward
+// union problem for DataFlowSolver. phi results are defined at the top of
+// their block and phi operands are used at the bottom of the predecessor they
+// flow in from.
+class SSALivenessProblem {
+public:
+  struct Summary {
+    BitVector gen;
+    BitVector not_prsv;
+  };
+  using Lattice = BitVector;
+  static const DataFlowDirection direction = DataFlowDirection::backward;
+
+  // numbers holds every value the procedure references. exit holds the
+  // values that are live out of the blocks without successors, and is sized
+  // to the number of values.
+  SSALivenessProblem(const IlocProcedure &proc,
+                     const std::unordered_map<Value, unsigned int> &numbers,
+                     BitVector exit);
+  Summary summarize(const BasicBlock &block);
+  Lattice top();
+  Lattice boundary();
+  void meet(Lattice &into, const Lattice &from);
+  bool transfer(const Summary &summary, const Lattice &out, Lattice &in);
+
+  // adds the operands the phis of block's successors take from it
+  void addPhiOperands(const BasicBlock &block, BitVector &bits) const;
+
+private:
+  const IlocProcedure &_proc;
+  const std::unordered_map<Value, unsigned int> &_numbers;
+  BitVector _exit;
+};
@@ -2,98 +2,60 @@
 
 #include "dominancefrontiers.h"
 #include "dominatortreepass.h"
+#include "iterateddominancefrontier.h"
 #include "livevariableanalysispass.h"
 #include "ssapass.h"
 
 SSAPass::SSAPass() : PDTreePass(DominatorTreePass::Mode::postdominator) {}
 
-IlocProgram SSAPass::applyToProgram(IlocProgram prog) {
+void SSAPass::run(IlocProgram &prog) {
   std::cerr << "converting to ssa and doing global common subexpression "
                "elimination\n";
 
-  DTreePass.applyToProgram(prog);
-  PDTreePass.applyToProgram(prog);
+  DTreePass.run(prog);
+  PDTreePass.run(prog);
 
   for (auto &proc : prog.getProceduresReference()) {
-    placePhiNodes(prog, proc);
+    placePhiNodes(proc);
     renameInit(proc);
     rename(proc.getBlockReference("entry"), proc);
   }
 
   prog.setIsSSA(true);
-
-  return prog;
 }
 
-void SSAPass::placePhiNodes(IlocProgram &prog, IlocProcedure &proc) {
+void SSAPass::placePhiNodes(IlocProcedure &proc) {
+  // liveness is computed on demand for just this procedure
   LiveVariableAnalysisPass<SoftValueSet> LVAPass;
-  LVAPass.applyToProgram(prog);
 
   // clear phi nodes (in case we're running a second time)
-  for (auto blockCopy : proc.orderedBlocks()) {
-    auto &block = proc.getBlockReference(blockCopy.debugName);
+  for (auto &block : proc.orderedBlocksReference()) {
     block.phinodes.clear();
   }
 
   // insert phi nodes
+  IteratedDominanceFrontier iteratedDF(proc, DTreePass.getDominatorTree(proc));
+  auto definitionSites = proc.getDefinitionSites();
+  unsigned int entryId = proc.getBlockId("entry");
+
   for (auto var : proc.getAllVariableNames()) {
-    std::set<BasicBlock> iterDomFront = iteratedDominanceFrontier(var, proc);
-    for (auto block : iterDomFront) {
-      DataFlowSets<SoftValueSet> sets = LVAPass.getBlockSets(proc, block);
+    // every variable has an implicit definition on entry
+    std::vector<unsigned int> sites = definitionSites[var.getNameSymbol()];
+    sites.push_back(entryId);
+
+    for (auto blockId : iteratedDF.compute(sites)) {
+      BasicBlock &block = proc.getBlockReference(blockId);
+      const DataFlowSets<SoftValueSet> &sets =
+          LVAPass.getBlockSets(proc, block);
       if (sets.in.find(var) != sets.in.end()) {
         PhiNode phi(var);
         for (auto pred : block.before) {
           phi.addRValue(proc.getBlock(pred), var);
         }
-        proc.getBlockReference(block.debugName).phinodes.push_back(phi);
-      }
-    }
-  }
-}
-
-std::set<BasicBlock> SSAPass::iteratedDominanceFrontier(Value variable,
-                                                        IlocProcedure proc) {
-  // construct S: (entry U every block with a definition of variable)
-  std::set<BasicBlock> work;
-  work.insert(proc.getBlock("entry"));
-  for (auto block : proc.orderedBlocks()) {
-    bool found = false;
-    for (auto inst : block.instructions) {
-      for (auto value : inst.operation.lvalues) {
-        if (value.getName() == variable.getName()) {
-          work.insert(block);
-          found = true;
-          break;
-        }
+        block.phinodes.push_back(phi);
       }
-      if (found == true)
-        break;
     }
   }
-
-  DominanceFrontiers frontiers(DTreePass.getDominatorTree(proc));
-  std::set<BasicBlock> iteratedDF;
-
-  while (!work.empty()) {
-    BasicBlock block = *work.begin();
-    work.erase(block);
-
-    for (auto blockInFrontier : frontiers.getDominanceFrontier(block)) {
-      if (iteratedDF.find(blockInFrontier) == iteratedDF.end()) {
-        // not in the set
-        iteratedDF.insert(blockInFrontier);
-        work.insert(blockInFrontier);
-      }
-    }
-  }
-
-  // debug output
-  // std::cerr << "iterated dominance frontier of " << variable.getName() <<
-  // ":\n"; for (auto block : iteratedDF) {
-  //   std::cerr << "   " << block.debugName << std::endl;
-  // }
-
-  return iteratedDF;
 }
 
 void SSAPass::renameInit(IlocProcedure &proc) {
@@ -102,30 +64,30 @@ void SSAPass::renameInit(IlocProcedure &proc) {
   nextNameMap.clear();
 
   for (auto var : proc.getAllVariableNames()) {
-    nameStackMap.insert({var.getName(), std::stack<Value>()});
+    nameStackMap.insert({var.getNameSymbol(), std::stack<Value>()});
   }
 
   // initialize argument register stacks
   for (auto &arg : proc.getFrameReference().arguments) {
     arg.setSubscript(newSubscript(arg));
-    nameStackMap.at(arg.getName()).push(arg);
+    nameStackMap.at(arg.getNameSymbol()).push(arg);
   }
 
   // initialize special register stacks
   Value zeroValue =
       Value("%vr0", Value::Type::virtualReg, Value::Behavior::memory);
   zeroValue.setSubscript(newSubscript(zeroValue));
-  nameStackMap.at("%vr0").push(zeroValue);
+  nameStackMap.at(zeroValue.getNameSymbol()).push(zeroValue);
 
   Value oneValue =
       Value("%vr1", Value::Type::virtualReg, Value::Behavior::memory);
   oneValue.setSubscript(newSubscript(oneValue));
-  nameStackMap.at("%vr1").push(oneValue);
+  nameStackMap.at(oneValue.getNameSymbol()).push(oneValue);
 
   Value twoValue =
       Value("%vr2", Value::Type::virtualReg, Value::Behavior::memory);
   twoValue.setSubscript(newSubscript(twoValue));
-  nameStackMap.at("%vr2").push(twoValue);
+  nameStackMap.at(twoValue.getNameSymbol()).push(twoValue);
 
   // initialize seen expressions map
   seenExpressionsMapStack.clear();
@@ -149,7 +111,7 @@ void SSAPass::rename(BasicBlock &block, IlocProcedure &proc) {
 
     for (auto &rvalue : inst.operation.rvalues) {
       if (rvalue.getType() == Value::Type::virtualReg) {
-        rvalue = nameStackMap.at(rvalue.getName()).top();
+        rvalue = nameStackMap.at(rvalue.getNameSymbol()).top();
       }
     }
 
@@ -186,22 +148,20 @@ void SSAPass::rename(BasicBlock &block, IlocProcedure &proc) {
   }
 
   // connect phi nodes
-  for (auto succName : block.after) {
-    BasicBlock &successor = proc.getBlockReference(succName);
+  for (auto succId : block.after) {
+    BasicBlock &successor = proc.getBlockReference(succId);
     for (auto &phi : successor.phinodes) {
       if (phi.isDeleted() == true)
         continue;
 
       phi.replaceRValue(block,
-                        nameStackMap.at(phi.getLValue().getName()).top());
+                        nameStackMap.at(phi.getLValue().getNameSymbol()).top());
     }
   }
 
   // recurse
-  for (auto child : DTreePass.getDominatorTree(proc)
-                        .findNodeByBlockname(block.debugName)
-                        .getChildren()) {
-    BasicBlock &next = proc.getBlockReference(child.getBasicBlock().debugName);
+  for (auto childId : DTreePass.getDominatorTree(proc).getChildren(block.id)) {
+    BasicBlock &next = proc.getBlockReference(childId);
     rename(next, proc);
   }
 
@@ -236,21 +196,20 @@ void SSAPass::rename(BasicBlock &block, IlocProcedure &proc) {
 Value SSAPass::pushNewName(Value val) {
   Value newVal = val;
   newVal.setSubscript(newSubscript(val));
-  nameStackMap.at(newVal.getName()).push(newVal);
+  nameStackMap.at(newVal.getNameSymbol()).push(newVal);
 
   return newVal;
 }
 
 Value SSAPass::popNameStack(Value val) {
-  Value r = nameStackMap.at(val.getName()).top();
-  nameStackMap.at(val.getName()).pop();
+  Value r = nameStackMap.at(val.getNameSymbol()).top();
+  nameStackMap.at(val.getNameSymbol()).pop();
   return r;
 }
 
-std::string SSAPass::newSubscript(Value val) {
-  std::string name = std::to_string(nextNameMap[val.getName()]);
-  nextNameMap[val.getName()]++;
-  return name;
+SymbolTable::Symbol SSAPass::newSubscript(Value val) {
+  unsigned int next = nextNameMap[val.getNameSymbol()]++;
+  return SymbolTable::intern(std::to_string(next));
 }
 
 void SSAPass::startBlock() {
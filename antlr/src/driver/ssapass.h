@@ -10,23 +10,21 @@
 class SSAPass : public Pass {
 public:
   SSAPass();
-  IlocProgram applyToProgram(IlocProgram prog);
+  void run(IlocProgram &prog);
 
 private:
   DominatorTreePass DTreePass;
   DominatorTreePass PDTreePass;
-  std::set<BasicBlock> iteratedDominanceFrontier(Value variable,
-                                                 IlocProcedure proc);
 
-  void placePhiNodes(IlocProgram &prog, IlocProcedure &proc);
+  void placePhiNodes(IlocProcedure &proc);
 
   void renameInit(IlocProcedure &proc);
   void rename(BasicBlock &block, IlocProcedure &proc);
   Value pushNewName(Value val);
   Value popNameStack(Value val);
-  std::string newSubscript(Value val);
-  std::unordered_map<std::string, std::stack<Value>> nameStackMap;
-  std::unordered_map<std::string, unsigned int> nextNameMap;
+  SymbolTable::Symbol newSubscript(Value val);
+  std::unordered_map<SymbolTable::Symbol, std::stack<Value>> nameStackMap;
+  std::unordered_map<SymbolTable::Symbol, unsigned int> nextNameMap;
 
   std::vector<
       std::unordered_map<Value, Operation, ValueNameHash, ValueNameEqual>>
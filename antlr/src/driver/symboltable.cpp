@@ -0,0 +1,30 @@
+#include "symboltable.h"
+
+SymbolTable::SymbolTable() {
+  _texts.push_back("");
+  _symbols.insert({"", empty});
+}
+
+SymbolTable &SymbolTable::instance() {
+  static SymbolTable table;
+  return table;
+}
+
+SymbolTable::Symbol SymbolTable::intern(const std::string &text) {
+  SymbolTable &table = instance();
+
+  auto found = table._symbols.find(text);
+  if (found != table._symbols.end()) {
+    return found->second;
+  }
+
+  Symbol symbol = table._texts.size();
+  table._texts.push_back(text);
+  table._symbols.insert({text, symbol});
+
+  return symbol;
+}
+
+const std::string &SymbolTable::text(Symbol symbol) {
+  return instance()._texts.at(symbol);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+// interns names so that values can carry, hash, and compare small integer
+// handles instead of strings. the text behind a symbol is only needed when
+// code is emitted or dumped.
+class SymbolTable {
+public:
+  using Symbol = unsigned int;
+
+  // the empty string is always symbol 0
+  static const Symbol empty = 0;
+
+  static Symbol intern(const std::string &text);
+  static const std::string &text(Symbol symbol);
+
+private:
+  SymbolTable();
+  static SymbolTable &instance();
+
+  // a deque never moves its elements, so references handed out by text()
+  // stay valid as more symbols are interned
+  std::deque<std::string> _texts;
+  std::unordered_map<std::string, Symbol> _symbols;
+};
@@ -0,0 +1,277 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "targetmachine.h"
+
+const std::vector<TargetMachine::RegisterClass> TargetMachine::classes = {
+    RegisterClass::integer, RegisterClass::floating};
+
+static const unsigned long maxRegisters = 1024;
+
+static unsigned int classIndex(TargetMachine::RegisterClass cls) {
+  return static_cast<unsigned int>(cls);
+}
+
+TargetMachine::TargetMachine(unsigned int integerRegisters,
+                             unsigned int floatRegisters)
+    : _registers{integerRegisters, floatRegisters}, _reserved{4, 0} {
+  // an operation reads two registers at once
+  if (integerRegisters < _reserved[0] + 2 ||
+      (floatRegisters > 0 && floatRegisters < 2)) {
+    throw "a target needs at least 2 registers to hand out in each class.";
+  }
+
+  // memory is the slow part, then multiplication and division
+  for (auto opcode :
+       {ilocParser::LOAD, ilocParser::LOADAI, ilocParser::LOADAO,
+        ilocParser::STORE, ilocParser::STOREAI, ilocParser::STOREAO,
+        ilocParser::FLOAD, ilocParser::FLOADAI, ilocParser::FLOADAO,
+        ilocParser::FSTORE, ilocParser::FSTOREAI, ilocParser::FSTOREAO}) {
+    _latencies[opcode] = 3;
+  }
+  for (auto opcode : {ilocParser::MULT, ilocParser::MULTI, ilocParser::FMULT,
+                      ilocParser::FADD, ilocParser::FSUB}) {
+    _latencies[opcode] = 2;
+  }
+  _latencies[ilocParser::MOD] = 4;
+  _latencies[ilocParser::FDIV] = 4;
+}
+
+TargetMachine TargetMachine::parse(const std::string &description) {
+  unsigned int integerRegisters = 8;
+  unsigned int floatRegisters = 0;
+
+  std::stringstream stream(description);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    std::string key = "int";
+    std::string count = item;
+    auto equals = item.find('=');
+    if (equals != std::string::npos) {
+      key = item.substr(0, equals);
+      count = item.substr(equals + 1);
+    }
+
+    // too many registers would only make the allocators' tables huge
+    unsigned long registers = maxRegisters + 1;
+    if (count.empty() ||
+        count.find_first_not_of("0123456789") != std::string::npos) {
+      throw "bad register count in target description: " + item;
+    }
+    try {
+      registers = std::stoul(count);
+    } catch (const std::out_of_range &) {
+    }
+    if (registers > maxRegisters) {
+      throw "bad register count in target description: " + item;
+    }
+
+    if (key == "int") {
+      integerRegisters = registers;
+    } else if (key == "float") {
+      floatRegisters = registers;
+    } else {
+      throw "unknown register class in target description: " + key;
+    }
+  }
+
+  return TargetMachine(integerRegisters, floatRegisters);
+}
+
+unsigned int TargetMachine::getRegisters(RegisterClass cls) const {
+  return _registers[classIndex(cls)];
+}
+
+unsigned int TargetMachine::getReservedRegisters(RegisterClass cls) const {
+  return _reserved[classIndex(cls)];
+}
+
+int TargetMachine::getReservedRegister(const std::string &name) const {
+  if (name.compare(0, 3, "%vr") != 0)
+    return -1;
+
+  auto end = name.find_first_not_of("0123456789", 3);
+  if (end == std::string::npos)
+    end = name.size();
+  if (end == 3 || end - 3 > 9 ||
+      (end != name.size() && name.substr(end) != "_0"))
+    return -1;
+
+  unsigned int reg = std::stoul(name.substr(3, end - 3));
+  if (reg >= getReservedRegisters(RegisterClass::integer))
+    return -1;
+  return getFirstRegister(RegisterClass::integer) + reg;
+}
+
+unsigned int TargetMachine::getFirstRegister(RegisterClass cls) const {
+  unsigned int first = 0;
+  for (unsigned int i = 0; i < classIndex(cls); i++) {
+    first += _registers[i];
+  }
+  return first;
+}
+
+unsigned int TargetMachine::getFirstAllocatable(RegisterClass cls) const {
+  return getFirstRegister(cls) + getReservedRegisters(cls);
+}
+
+unsigned int TargetMachine::getEndRegister(RegisterClass cls) const {
+  return getFirstRegister(cls) + getRegisters(cls);
+}
+
+unsigned int
+TargetMachine::getAllocatableRegisters(RegisterClass cls) const {
+  return getRegisters(cls) - getReservedRegisters(cls);
+}
+
+bool TargetMachine::isAllocatable(RegisterClass cls, int reg) const {
+  return reg >= static_cast<int>(getFirstAllocatable(cls)) &&
+         reg < static_cast<int>(getEndRegister(cls));
+}
+
+unsigned int TargetMachine::getTotalRegisters() const {
+  return getEndRegister(RegisterClass::floating);
+}
+
+TargetMachine::RegisterClass
+TargetMachine::getRegisterClass(unsigned int reg) const {
+  for (auto cls : classes) {
+    if (reg < getEndRegister(cls)) {
+      return cls;
+    }
+  }
+  throw "register " + std::to_string(reg) + " isn't on the target.";
+}
+
+TargetMachine::RegisterClass
+TargetMachine::getAllocationClass(RegisterClass cls) const {
+  if (getRegisters(cls) == 0) {
+    return RegisterClass::integer;
+  }
+  return cls;
+}
+
+std::unordered_map<Value, TargetMachine::RegisterClass>
+TargetMachine::classifyValues(const IlocProcedure &proc) const {
+  // a value is a float if anything treats it as one
+  std::unordered_map<Value, RegisterClass> valueClasses;
+  auto reference = [&](const Operation &op, const Value &value, bool lvalue,
+                       unsigned int index) {
+    if (value.getType() != Value::Type::virtualReg)
+      return;
+
+    RegisterClass &cls =
+        valueClasses.insert({value, RegisterClass::integer}).first->second;
+    if (operandClass(op, lvalue, index) == RegisterClass::floating) {
+      cls = RegisterClass::floating;
+    }
+  };
+
+  for (const auto &block : proc.orderedBlocks()) {
+    for (const auto &inst : block.instructions) {
+      if (inst.isDeleted())
+        continue;
+
+      const Operation &op = inst.operation;
+      for (unsigned int i = 0; i < op.lvalues.size(); i++) {
+        reference(op, op.lvalues[i], true, i);
+      }
+      for (unsigned int i = 0; i < op.rvalues.size(); i++) {
+        reference(op, op.rvalues[i], false, i);
+      }
+    }
+  }
+
+  for (auto &pair : valueClasses) {
+    pair.second = getAllocationClass(pair.second);
+  }
+  return valueClasses;
+}
+
+void TargetMachine::checkArguments(const IlocProcedure &proc) const {
+  std::unordered_map<Value, RegisterClass> valueClasses = classifyValues(proc);
+  std::vector<unsigned int> arguments(classes.size(), 0);
+  for (const auto &argValue : proc.getFrame().arguments) {
+    auto it = valueClasses.find(argValue);
+    RegisterClass cls = it == valueClasses.end()
+                            ? getAllocationClass(RegisterClass::integer)
+                            : it->second;
+    if (++arguments[classIndex(cls)] > getAllocatableRegisters(cls)) {
+      throw "procedure " + proc.getFrame().name +
+          " takes more arguments than the target has registers to hand out.";
+    }
+  }
+}
+
+std::vector<TargetMachine::RegisterClass>
+TargetMachine::classifyRanges(const IlocProcedure &proc,
+                              const LiveRanges &ranges) const {
+  // a range is a float if any of its values is
+  std::vector<RegisterClass> rangeClasses(ranges.size(),
+                                          RegisterClass::integer);
+  for (const auto &pair : classifyValues(proc)) {
+    if (pair.second == RegisterClass::floating) {
+      rangeClasses[ranges.getRangeWithValue(pair.first).id] =
+          RegisterClass::floating;
+    }
+  }
+  return rangeClasses;
+}
+
+TargetMachine::RegisterClass
+TargetMachine::operandClass(const Operation &op, bool lvalue,
+                            unsigned int index) {
+  switch (op.opcode) {
+  case ilocParser::FADD:
+  case ilocParser::FSUB:
+  case ilocParser::FMULT:
+  case ilocParser::FDIV:
+  case ilocParser::F2F:
+    return RegisterClass::floating;
+
+  // conversions and comparisons only have a float on one side
+  case ilocParser::I2F:
+  case ilocParser::FLOAD:
+  case ilocParser::FLOADAI:
+  case ilocParser::FLOADAO:
+    return lvalue ? RegisterClass::floating : RegisterClass::integer;
+  case ilocParser::F2I:
+  case ilocParser::FCOMP:
+  case ilocParser::FWRITE:
+  case ilocParser::FRET:
+    return lvalue ? RegisterClass::integer : RegisterClass::floating;
+
+  // the rest of the operands are addresses
+  case ilocParser::FSTORE:
+  case ilocParser::FSTOREAI:
+  case ilocParser::FSTOREAO:
+    return !lvalue && index == 0 ? RegisterClass::floating
+                                 : RegisterClass::integer;
+
+  // the arguments that follow the return value can be anything, they are
+  // classified by the rest of their references
+  case ilocParser::FCALL:
+    return lvalue && index == 0 ? RegisterClass::floating
+                                : RegisterClass::integer;
+
+  default:
+    return RegisterClass::integer;
+  }
+}
+
+unsigned int TargetMachine::getLatency(uint opcode) const {
+  auto it = _latencies.find(opcode);
+  return it == _latencies.end() ? 1 : it->second;
+}
+
+std::string TargetMachine::describe() const {
+  std::string text =
+      std::to_string(getRegisters(RegisterClass::integer)) + " registers";
+  if (getRegisters(RegisterClass::floating) > 0) {
+    text = std::to_string(getRegisters(RegisterClass::integer)) +
+           " integer and " +
+           std::to_string(getRegisters(RegisterClass::floating)) +
+           " float registers";
+  }
+  return text;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ilocprocedure.h"
+#include "instruction.h"
+#include "liverangespass.h"
+
+// the machine registers are allocated for: its register classes, how many
+// registers each has, which of them are reserved, and how many cycles each
+// operation takes. every class is numbered after the one before it, so
+// integer registers are %vr0 up and float registers follow them. the
+// reserved integer registers, four by default, are the special registers %vr0
+// up, which are never handed out.
+//
+// without float registers of its own, the machine keeps floats in integer
+// registers.
+class TargetMachine {
+public:
+  enum class RegisterClass { integer, floating };
+  static const std::vector<RegisterClass> classes;
+
+  TargetMachine(unsigned int integerRegisters = 8,
+                unsigned int floatRegisters = 0);
+  // reads a description like "int=12,float=4". a plain number is the number
+  // of integer registers.
+  static TargetMachine parse(const std::string &description);
+
+  // number of registers of a class, reserved ones included
+  unsigned int getRegisters(RegisterClass cls) const;
+  unsigned int getReservedRegisters(RegisterClass cls) const;
+  // the special register a name like %vr2 stands for, or -1. in ssa only
+  // %vr2_0, the value it holds when the procedure starts, is the register.
+  int getReservedRegister(const std::string &name) const;
+  // registers a class can hand out, [first, end)
+  unsigned int getFirstAllocatable(RegisterClass cls) const;
+  unsigned int getEndRegister(RegisterClass cls) const;
+  unsigned int getAllocatableRegisters(RegisterClass cls) const;
+  bool isAllocatable(RegisterClass cls, int reg) const;
+  unsigned int getTotalRegisters() const;
+  RegisterClass getRegisterClass(unsigned int reg) const;
+
+  // class whose registers values of a class are kept in
+  RegisterClass getAllocationClass(RegisterClass cls) const;
+  // allocation class of each register value a procedure references, from
+  // the operations that reference it
+  std::unordered_map<Value, RegisterClass>
+  classifyValues(const IlocProcedure &proc) const;
+  // every argument arrives in a register of its own, so a procedure that
+  // takes more of a class than the class hands out can't be allocated.
+  // throws if it does.
+  void checkArguments(const IlocProcedure &proc) const;
+  // allocation class of each live range of a procedure, by id, from the
+  // operations that reference it
+  std::vector<RegisterClass> classifyRanges(const IlocProcedure &proc,
+                                            const LiveRanges &ranges) const;
+
+  unsigned int getLatency(uint opcode) const;
+  std::string describe() const;
+
+private:
+  static RegisterClass operandClass(const Operation &op, bool lvalue,
+                                    unsigned int index);
+  unsigned int getFirstRegister(RegisterClass cls) const;
+
+  // class -> count
+  std::vector<unsigned int> _registers;
+  std::vector<unsigned int> _reserved;
+  // opcode -> cycles, anything missing takes one
+  std::unordered_map<uint, unsigned int> _latencies;
+};
@@ -0,0 +1,47 @@
+#include <utility>
+
+#include "unionfind.h"
+
+UnionFind::UnionFind(unsigned int size) : _parents(size), _sizes(size, 1) {
+  for (unsigned int i = 0; i < size; i++) {
+    _parents[i] = i;
+  }
+}
+
+unsigned int UnionFind::size() const { return _parents.size(); }
+
+unsigned int UnionFind::add() {
+  _parents.push_back(_parents.size());
+  _sizes.push_back(1);
+  return _parents.size() - 1;
+}
+
+unsigned int UnionFind::find(unsigned int x) {
+  unsigned int root = x;
+  while (_parents[root] != root) {
+    root = _parents[root];
+  }
+
+  // point everything on the path straight at the root
+  while (_parents[x] != root) {
+    unsigned int next = _parents[x];
+    _parents[x] = root;
+    x = next;
+  }
+
+  return root;
+}
+
+unsigned int UnionFind::unite(unsigned int a, unsigned int b) {
+  a = find(a);
+  b = find(b);
+  if (a == b)
+    return a;
+
+  if (_sizes[a] < _sizes[b]) {
+    std::swap(a, b);
+  }
+  _parents[b] = a;
+  _sizes[a] += _sizes[b];
+  return a;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+
+// disjoint sets over the integers [0, size). finds compress paths and unions
+// hang the smaller tree under the larger, so operations are nearly constant.
+class UnionFind {
+public:
+  explicit UnionFind(unsigned int size = 0);
+
+  unsigned int size() const;
+  // adds a new singleton set, returns its element
+  unsigned int add();
+  // representative of the set holding x
+  unsigned int find(unsigned int x);
+  // merges the sets holding a and b, returns the new representative
+  unsigned int unite(unsigned int a, unsigned int b);
+
+private:
+  std::vector<unsigned int> _parents;
+  std::vector<unsigned int> _sizes;
+};
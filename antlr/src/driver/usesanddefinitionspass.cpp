@@ -1,13 +1,11 @@
 #include "usesanddefinitionspass.h"
 
-IlocProgram UsesAndDefinitionsPass::applyToProgram(IlocProgram prog) {
+void UsesAndDefinitionsPass::run(IlocProgram &prog) {
   for (auto &proc : prog.getProceduresReference()) {
     proc.getSSAInfoReference().definitionsMap.clear();
     proc.getSSAInfoReference().usesMap.clear();
     calculateSSAInfo(proc);
   }
-
-  return prog;
 };
 
 void UsesAndDefinitionsPass::calculateSSAInfo(IlocProcedure &proc) {
@@ -43,9 +41,7 @@ void UsesAndDefinitionsPass::calculateSSAInfo(IlocProcedure &proc) {
                               value, proc.getBlock("entry"))});
   }
 
-  for (auto blockCopy : proc.orderedBlocks()) {
-    BasicBlock &block = proc.getBlockReference(blockCopy.debugName);
-
+  for (const auto &block : proc.orderedBlocks()) {
     // instructions
     for (auto inst : block.instructions) {
       // skip deleted
@@ -4,8 +4,6 @@
 
 class UsesAndDefinitionsPass : public Pass {
 public:
-  IlocProgram applyToProgram(IlocProgram proc);
-
-private:
+  void run(IlocProgram &prog);
   void calculateSSAInfo(IlocProcedure &proc);
 };
\ No newline at end of file
@@ -1,10 +1,15 @@
 #include "value.h"
 
 Value::Value(std::string _name, Type _type, Behavior _beh)
-    : type(_type), behavior(_beh), name(_name) {}
+    : type(_type), behavior(_beh), name(SymbolTable::intern(_name)),
+      subscript(SymbolTable::empty) {}
 
-std::string Value::getName() const { return name; }
-std::string Value::getSubscript() const { return subscript; }
+const std::string &Value::getName() const { return SymbolTable::text(name); }
+const std::string &Value::getSubscript() const {
+  return SymbolTable::text(subscript);
+}
+SymbolTable::Symbol Value::getNameSymbol() const { return name; }
+SymbolTable::Symbol Value::getSubscriptSymbol() const { return subscript; }
 Value::Type Value::getType() const { return type; }
 void Value::setBehavior(Value::Behavior b) { behavior = b; }
 Value::Behavior Value::getBehavior() const { return behavior; }
@@ -16,16 +21,40 @@ std::string Value::getFullText() const {
   }
 }
 
-void Value::setName(std::string newname) { name = newname; }
-void Value::setSubscript(std::string sub) { subscript = sub; }
+void Value::setName(std::string newname) {
+  name = SymbolTable::intern(newname);
+}
+void Value::setName(SymbolTable::Symbol newname) { name = newname; }
+void Value::setSubscript(std::string sub) {
+  subscript = SymbolTable::intern(sub);
+}
+void Value::setSubscript(SymbolTable::Symbol sub) { subscript = sub; }
 void Value::setType(Value::Type t) { type = t; }
 
 bool operator==(const Value &a, const Value &b) {
-  return a.getFullText() == b.getFullText() && a.getType() == b.getType();
+  if (a.getType() != b.getType() || a.getNameSymbol() != b.getNameSymbol()) {
+    return false;
+  }
+
+  // the subscript is only part of the text of virtual registers
+  return a.getType() != Value::Type::virtualReg ||
+         a.getSubscriptSymbol() == b.getSubscriptSymbol();
 }
 
 bool operator!=(const Value &a, const Value &b) { return !(a == b); }
 
 bool operator<(const Value &a, const Value &b) {
-  return a.getFullText() < b.getFullText();
+  if (a.getNameSymbol() != b.getNameSymbol()) {
+    return a.getNameSymbol() < b.getNameSymbol();
+  }
+
+  if (a.getType() != b.getType()) {
+    return a.getType() < b.getType();
+  }
+
+  if (a.getType() == Value::Type::virtualReg) {
+    return a.getSubscriptSymbol() < b.getSubscriptSymbol();
+  }
+
+  return false;
 }
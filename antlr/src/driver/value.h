@@ -4,6 +4,8 @@
 
 #include "ilocParser.h"
 
+#include "symboltable.h"
+
 class Value {
 public:
   enum class Type { unknown, virtualReg, number, label };
@@ -15,37 +17,45 @@ public:
   Type getType() const;
   void setBehavior(Value::Behavior b);
   Behavior getBehavior() const;
-  std::string getName() const;
-  std::string getSubscript() const;
+  const std::string &getName() const;
+  const std::string &getSubscript() const;
+  SymbolTable::Symbol getNameSymbol() const;
+  SymbolTable::Symbol getSubscriptSymbol() const;
   std::string getFullText() const;
   void setName(std::string name);
+  void setName(SymbolTable::Symbol name);
   void setSubscript(std::string sub);
+  void setSubscript(SymbolTable::Symbol sub);
 
   void setType(Type t);
 
 private:
   Type type;
   Behavior behavior;
-  std::string name;
-  std::string subscript;
+  SymbolTable::Symbol name;
+  SymbolTable::Symbol subscript;
 };
 
 struct ValueNameHash {
   std::size_t operator()(const Value &v) const noexcept {
-    return std::hash<std::string>{}(v.getName());
+    return std::hash<SymbolTable::Symbol>{}(v.getNameSymbol());
   }
 };
 
 struct ValueNameEqual {
   std::size_t operator()(const Value &a, const Value &b) const noexcept {
-    return a.getName() == b.getName();
+    return a.getNameSymbol() == b.getNameSymbol();
   }
 };
 
 namespace std {
 template <> struct hash<Value> {
   std::size_t operator()(const Value &v) const noexcept {
-    return std::hash<std::string>{}(v.getFullText());
+    // only virtual registers carry a meaningful subscript
+    std::size_t sub = v.getType() == Value::Type::virtualReg
+                          ? v.getSubscriptSymbol()
+                          : SymbolTable::empty;
+    return (static_cast<std::size_t>(v.getNameSymbol()) << 32) ^ sub;
   }
 };
 } // namespace std
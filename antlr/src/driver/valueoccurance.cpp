@@ -1,15 +1,16 @@
 #include "valueoccurance.h"
 
-ValueOccurance::ValueOccurance(Tag t, BasicBlock block)
-    : tag{t}, containingBlock{block.debugName} {}
+ValueOccurance::ValueOccurance(Tag t, const BasicBlock &block)
+    : tag{t}, containingBlock{block.id} {}
 
-PhiNodeValueOccurance::PhiNodeValueOccurance(PhiNode phi, BasicBlock block)
+PhiNodeValueOccurance::PhiNodeValueOccurance(PhiNode phi,
+                                             const BasicBlock &block)
     : ValueOccurance(ValueOccurance::Tag::phinode, block), phinode{phi} {}
 
 InstructionValueOccurance::InstructionValueOccurance(Instruction instr,
-                                                     BasicBlock block)
+                                                     const BasicBlock &block)
     : ValueOccurance(ValueOccurance::Tag::instruction, block), inst{instr} {}
 
 PredefinedValueOccurance::PredefinedValueOccurance(Value value,
-                                                   BasicBlock block)
+                                                   const BasicBlock &block)
     : ValueOccurance(ValueOccurance::Tag::predefined, block), val{value} {}
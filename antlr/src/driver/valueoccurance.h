@@ -8,31 +8,31 @@ class ValueOccurance {
 public:
   enum class Tag { phinode, instruction, predefined };
   const Tag tag;
-  const std::string containingBlock;
+  const unsigned int containingBlock;
 
   virtual ~ValueOccurance() = default;
 
 protected:
-  ValueOccurance(Tag t, BasicBlock block);
+  ValueOccurance(Tag t, const BasicBlock &block);
 
 private:
 };
 
 class PhiNodeValueOccurance : public ValueOccurance {
 public:
-  PhiNodeValueOccurance(PhiNode phi, BasicBlock block);
+  PhiNodeValueOccurance(PhiNode phi, const BasicBlock &block);
   const PhiNode phinode;
 };
 
 class InstructionValueOccurance : public ValueOccurance {
 public:
-  InstructionValueOccurance(Instruction inst, BasicBlock block);
+  InstructionValueOccurance(Instruction inst, const BasicBlock &block);
   const Instruction inst;
 };
 
 class PredefinedValueOccurance : public ValueOccurance {
 public:
-  PredefinedValueOccurance(Value val, BasicBlock block);
+  PredefinedValueOccurance(Value val, const BasicBlock &block);
   const Value val;
 };
 